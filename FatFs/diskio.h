@@ -7,7 +7,7 @@
 
 #ifndef _DISKIO
 
-#define _READONLY   1                   /* 1: Remove write functions */
+#define _READONLY   0                   /* 1: Remove write functions */
 #define _USE_IOCTL  1                   /* 1: Use disk_ioctl fucntion */
 
 #include "fatfs-types.h"
@@ -69,6 +69,7 @@ DRESULT disk_ioctl(BYTE, BYTE, DWORD*); //KLQ Changed from void* to DWORD*
 #define MMC_GET_CID         12          /* Get CID */
 #define MMC_GET_OCR         13          /* Get OCR */
 #define MMC_GET_SDSTAT      14          /* Get SD status */
+#define MMC_GET_CACHE_STATS 15          /* Get sector cache hits and misses */
 
 /* ATA/CF specific ioctl command */
 #define ATA_GET_REV         20          /* Get F/W revision */
@@ -2488,6 +2488,51 @@ FRESULT f_open (
     LEAVE_FF(dj.fs, res);
 }
 
+/*
+ *-----------------------------------------------------------------------
+ * Open a File for Reading from its Start Cluster and Size
+ *-----------------------------------------------------------------------
+ */
+
+FRESULT f_open_cluster (
+    FIL *fp,                                                                /* Pointer to the blank file object */
+    DWORD sclust,                                                           /* File start cluster, from a previous f_open() */
+    DWORD fsize                                                             /* File size */
+    )
+{
+    FRESULT res;
+    FATFS *fs;
+    const TCHAR *path = "";
+
+
+    fp->fs = 0;                                                             /* Clear file object */
+
+    res = chk_mounted(&path, &fs, 0);
+    if (res == FR_OK){
+        if (fsize && (sclust < 2 || sclust >= fs->n_fatent)){               /* No directory lookup, so check the cluster */
+            res = FR_INT_ERR;
+        }
+    }
+
+    if (res == FR_OK){
+        fp->flag = FA_READ;                                                 /* Read only, there is no directory entry */
+        fp->org_clust = sclust;                                             /* File start cluster */
+        fp->fsize = fsize;                                                  /* File size */
+        fp->fptr = 0;                                                       /* File pointer */
+        fp->dsect = 0;
+#if !_FS_READONLY
+        fp->dir_sect = 0;
+        fp->dir_ptr = 0;
+#endif
+#if _USE_FASTSEEK
+        fp->cltbl = 0;                                                      /* No cluster link map table */
+#endif
+        fp->fs = fs; fp->id = fs->id;                                       /* Validate file object */
+    }
+
+    LEAVE_FF(fs, res);
+}
+
 /*
  *-----------------------------------------------------------------------
  * Read File
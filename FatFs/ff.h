@@ -667,6 +667,7 @@ typedef enum {
 
 FRESULT f_mount(BYTE, FATFS*);                                      /* Mount/Unmount a logical drive */
 FRESULT f_open(FIL *, const TCHAR *, BYTE);                         /* Open or create a file */
+FRESULT f_open_cluster(FIL *, DWORD, DWORD);                        /* Open a file from its start cluster and size */
 FRESULT f_read(FIL *, void*, UINT, UINT*);                          /* Read data from a file */
 FRESULT f_lseek(FIL *, DWORD);                                      /* Move file pointer of a file object */
 FRESULT f_close (FIL*);                                             /* Close an open file object */
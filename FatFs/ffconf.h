@@ -23,13 +23,17 @@
  * /  data transfer. This reduces memory consumption 512 bytes each file object. */
 
 
-#define _FS_READONLY    1   /* 0:Read/Write or 1:Read only */
+#define _FS_READONLY    0   /* 0:Read/Write or 1:Read only */
 /* Setting _FS_READONLY to 1 defines read only configuration. This removes
  * /  writing functions, f_write, f_sync, f_unlink, f_mkdir, f_chmod, f_rename,
  * /  f_truncate and useless f_getfree. */
 
 
-#define _FS_MINIMIZE    1   /* 0 to 3 */
+#define _FS_MINIMIZE    0   /* 0 to 3 */
+/* 0 is needed for f_stat, used by the slideshow to detect changes in its
+ * directory.  As _FS_READONLY is 0 for the trace file, this also builds
+ * f_getfree, f_unlink, f_mkdir, f_chmod, f_truncate and f_rename, which are
+ * not used. */
 /* The _FS_MINIMIZE option defines minimization level to remove some functions.
  * /
  * /   0: Full function.
@@ -15,6 +15,7 @@
  * ---------------------------------------------------------------------------*/
 
 #include <intrinsics.h>                                                 /* Include MSP430-specific intrincs */
+#include <string.h>
 #include "diskio.h"                                                     /* Common include file for FatFs and disk I/O layer */
 #include "msp430-sdcard.h"                                                 /* MSP-EXP430F5529 specific SD Card driver */
 
@@ -96,6 +97,31 @@ DSTATUS Stat = STA_NOINIT;                                              /* Disk
 static
 BYTE CardType;                                                          /* b0:MMC, b1:SDv1, b2:SDv2, b3:Block addressing */
 
+/*
+ *-------------------------------------------------------------------------
+ * LRU cache of single sector reads, i.e. FAT, directory and partial data
+ * sectors going through the FatFs window.  Set CACHE_SECTORS to 0 to disable.
+ *-------------------------------------------------------------------------
+ */
+#define CACHE_SECTORS   3                                               /* Number of cached sectors */
+
+#if CACHE_SECTORS
+static
+BYTE CacheData[CACHE_SECTORS][512];                                     /* Sector data */
+
+static
+DWORD CacheSector[CACHE_SECTORS];                                       /* LBA of each entry */
+
+static
+BYTE CacheValid[CACHE_SECTORS];                                         /* 1: entry holds a valid sector */
+
+static
+BYTE CacheOrder[CACHE_SECTORS];                                         /* Entry indexes, most recently used first */
+
+static
+DWORD CacheHits, CacheMisses;                                           /* Statistics, see MMC_GET_CACHE_STATS */
+#endif
+
 
 
 /*
@@ -307,6 +333,50 @@ BYTE send_cmd (                     /* Returns command response (bit7==1:Send fa
     return (d);                     /* Return with the response value */
 }
 
+#if CACHE_SECTORS
+/*
+ *-----------------------------------------------------------------------
+ * Sector cache
+ *-----------------------------------------------------------------------
+ */
+
+static
+void cache_invalidate (
+    DWORD sector,                                                       /* Start sector number (LBA) */
+    BYTE count                                                          /* Sector count, 0 for all sectors */
+    )
+{
+    BYTE i;
+
+
+    for (i = 0; i < CACHE_SECTORS; i++){
+        if (!count || (CacheSector[i] >= sector
+                       && CacheSector[i] - sector < count)){
+            CacheValid[i] = 0;
+        }
+        if (!count){
+            CacheOrder[i] = i;
+        }
+    }
+}
+
+static
+BYTE cache_use (                                                        /* Returns the entry index */
+    BYTE pos                                                            /* Position in CacheOrder */
+    )
+{
+    BYTE i = CacheOrder[pos];
+
+
+    for (; pos; pos--){                                                 /* Move it to the front */
+        CacheOrder[pos] = CacheOrder[pos - 1];
+    }
+    CacheOrder[0] = i;
+
+    return (i);
+}
+#endif
+
 /*--------------------------------------------------------------------------
  *
  * Public Functions
@@ -418,6 +488,9 @@ DSTATUS disk_initialize (
     }
     CardType = ty;
     deselect();
+#if CACHE_SECTORS
+    cache_invalidate(0, 0);                                             /* New card, empty the cache */
+#endif
 
     if (ty){                                                            /* Initialization succeded */
         FAST_MODE();
@@ -454,6 +527,24 @@ DRESULT disk_read (
     if (!count){
         return ( RES_PARERR) ;
     }
+#if CACHE_SECTORS
+    if (count == 1){                                                    /* Look up single sectors in the cache */
+        BYTE pos, i;
+
+        for (pos = 0; pos < CACHE_SECTORS; pos++){
+            i = CacheOrder[pos];
+            if (CacheValid[i] && CacheSector[i] == sector){
+                CacheHits++;
+                memcpy(buff, CacheData[cache_use(pos)], 512);
+                return (RES_OK);
+            }
+        }
+        CacheMisses++;
+        i = cache_use(CACHE_SECTORS - 1);                               /* Recycle the least recently used entry */
+        CacheValid[i] = 0;
+        CacheSector[i] = sector;
+    }
+#endif
     if (!(CardType & CT_BLOCK)){
         sector *= 512;                                                  /* Convert LBA to byte address if needed */
     }
@@ -461,6 +552,10 @@ DRESULT disk_read (
         if ((send_cmd(CMD17, sector) == 0)                              /* READ_SINGLE_BLOCK */
             && rcvr_datablock(buff, 512)){
             count = 0;
+#if CACHE_SECTORS
+            memcpy(CacheData[CacheOrder[0]], buff, 512);
+            CacheValid[CacheOrder[0]] = 1;
+#endif
         }
     } else {                                                            /* Multiple block read */
         if (send_cmd(CMD18, sector) == 0){                              /* READ_MULTIPLE_BLOCK */
@@ -504,6 +599,9 @@ DRESULT disk_write (
     if (!count){
         return ( RES_PARERR) ;
     }
+#if CACHE_SECTORS
+    cache_invalidate(sector, count);                                    /* Drop cached copies of these sectors */
+#endif
     if (!(CardType & CT_BLOCK)){
         sector *= 512;                                                  /* Convert LBA to byte address if needed */
     }
@@ -587,6 +685,14 @@ DRESULT disk_ioctl (
             res = RES_OK;
             break;
 
+#if CACHE_SECTORS
+        case MMC_GET_CACHE_STATS:                                       /* Get sector cache hits and misses (2 DWORDs) */
+            buff[0] = CacheHits;
+            buff[1] = CacheMisses;
+            res = RES_OK;
+            break;
+#endif
+
         default:
             res = RES_PARERR;
     }
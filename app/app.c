@@ -25,15 +25,37 @@
  */
 
 #include <pl/platform.h>
+#include <pl/epdpsu.h>
 #include "app.h"
+#include "event.h"
+#include "radio.h"
+#include "trace.h"
 
 #define LOG_TAG "app"
 #include "utils.h"
 
 static const char SLIDES_PATH[] = "img/slides.txt";
 
+/* Time between two runs of the background poll task, in ms */
+#define APP_POLL_MS 100
+
 int app_stop = 0;
 
+static struct app_task app_poll_task;
+
+static void app_poll(struct app_task *task)
+{
+	struct pl_platform *plat = task->data;
+
+	if (pl_epdpsu_poll(&plat->psu)) {
+		app_event_stop(-1);
+		return;
+	}
+
+	trace_poll();
+	app_task_post_delayed(task, APP_POLL_MS);
+}
+
 int app_demo(struct pl_platform *plat)
 {
 	int stat;
@@ -41,18 +63,41 @@ int app_demo(struct pl_platform *plat)
 	if (app_clear(plat))
 		return -1;
 
+	app_services_start(plat);
+
 	if (CONFIG_DEMO_POWERMODES)
 		stat = app_power(plat, "img");
 	else if (CONFIG_DEMO_PATTERN)
 		stat = app_pattern(plat);
+	else if (CONFIG_DEMO_RADIO_IMAGE)
+		stat = app_radio_image(plat);
 	else if (is_file_present(SLIDES_PATH))
 		stat = app_sequencer(plat, SLIDES_PATH);
 	else
 		stat = app_slideshow(plat, "img");
 
+	app_services_stop();
+
+	/* the keep-alive is not ended by the poll task any more */
+	if (pl_epdpsu_flush(&plat->psu))
+		stat = -1;
+
 	return stat;
 }
 
+void app_services_start(struct pl_platform *plat)
+{
+	app_task_init(&app_poll_task, app_poll, plat);
+	app_task_post_delayed(&app_poll_task, APP_POLL_MS);
+	app_radio_start(NULL);
+}
+
+void app_services_stop(void)
+{
+	app_radio_stop();
+	app_task_cancel(&app_poll_task);
+}
+
 #include <pl/endian.h>
 
 int app_clear(struct pl_platform *plat)
@@ -61,7 +106,7 @@ int app_clear(struct pl_platform *plat)
 	struct pl_epdc *epdc = &plat->epdc;
 	LOG("Clearing the screen");
 
-	if (psu->on(psu))
+	if (pl_epdpsu_on(psu))
 		return -1;
 
 	if (epdc->fill(epdc, NULL, PL_WHITE))
@@ -77,5 +122,5 @@ int app_clear(struct pl_platform *plat)
 	if (epdc->wait_update_end(epdc))
 		return -1;
 
-	return psu->off(psu);
+	return pl_epdpsu_off(psu);
 }
@@ -32,10 +32,17 @@ struct pl_platform;
 extern int app_stop;
 
 extern int app_demo(struct pl_platform *plat);
+
+/* Background tasks run by the event loop: EPD PSU keep-alive, trace buffer
+ * and radio reception */
+extern void app_services_start(struct pl_platform *plat);
+extern void app_services_stop(void);
+
 extern int app_clear(struct pl_platform *plat);
 extern int app_power(struct pl_platform *plat, const char *path);
 extern int app_slideshow(struct pl_platform *plat, const char *path);
 extern int app_sequencer(struct pl_platform *plat, const char *path);
 extern int app_pattern(struct pl_platform *plat);
+extern int app_radio_image(struct pl_platform *plat);
 
 #endif /* INCLUDE_APP_H */
@@ -0,0 +1,237 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2014 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * app/event.c -- Application event loop
+ *
+ */
+
+#include <app/app.h>
+#include <app/event.h>
+#include <msp430.h>
+#include <stdlib.h>
+#include "assert.h"
+
+#define LOG_TAG "event"
+#include "utils.h"
+
+/* Maximum time to sleep with nothing to poll, to check app_stop */
+#define APP_EVENT_IDLE_MS 1000
+
+static struct app_task *task_head;
+static struct app_task *task_tail;
+static struct app_io *io_list;
+static volatile uint8_t event_flag;	/* set when a task is queued */
+static uint8_t event_running;
+static int event_stat;
+
+/* Must be called with interrupts disabled */
+static struct app_task *pop_task(void)
+{
+	struct app_task *task = task_head;
+
+	if (task != NULL) {
+		task_head = task->next;
+
+		if (task_head == NULL)
+			task_tail = NULL;
+
+		task->next = NULL;
+		task->queued = 0;
+	}
+
+	return task;
+}
+
+/* Queue the tasks of the completed I/O events, return 1 if any was found */
+static int poll_io(void)
+{
+	struct app_io **it = &io_list;
+	int found = 0;
+
+	while (*it != NULL) {
+		struct app_io *io = *it;
+
+		if (io->ready(io)) {
+			*it = io->next;
+			io->next = NULL;
+			app_task_post(io->task);
+			found = 1;
+		} else {
+			it = &io->next;
+		}
+	}
+
+	return found;
+}
+
+static void task_timer_expired(struct time_timer *t)
+{
+	app_task_post(t->data);
+}
+
+void app_task_init(struct app_task *task, app_task_fn run, void *data)
+{
+	assert(task != NULL);
+	assert(run != NULL);
+
+	task->next = NULL;
+	task->run = run;
+	task->data = data;
+	task->timer.callback = task_timer_expired;
+	task->timer.data = task;
+	task->queued = 0;
+}
+
+void app_task_post(struct app_task *task)
+{
+	unsigned int gie = __get_SR_register() & GIE;
+
+	__disable_interrupt();
+
+	if (!task->queued) {
+		task->queued = 1;
+		task->next = NULL;
+
+		if (task_tail == NULL)
+			task_head = task;
+		else
+			task_tail->next = task;
+
+		task_tail = task;
+		event_flag = 1;
+	}
+
+	__bis_SR_register(gie);
+}
+
+void app_task_post_delayed(struct app_task *task, uint16_t ms)
+{
+	if (!ms) {
+		app_task_post(task);
+		return;
+	}
+
+	time_timer_cancel(&task->timer);
+	time_timer_add(&task->timer, TIME_MS_TO_TICKS(ms));
+}
+
+void app_task_cancel(struct app_task *task)
+{
+	unsigned int gie = __get_SR_register() & GIE;
+	struct app_task *prev = NULL;
+	struct app_task *it;
+
+	time_timer_cancel(&task->timer);
+
+	__disable_interrupt();
+
+	for (it = task_head; it != NULL; prev = it, it = it->next) {
+		if (it == task) {
+			if (prev == NULL)
+				task_head = task->next;
+			else
+				prev->next = task->next;
+
+			if (task_tail == task)
+				task_tail = prev;
+
+			task->next = NULL;
+			task->queued = 0;
+			break;
+		}
+	}
+
+	__bis_SR_register(gie);
+}
+
+void app_io_init(struct app_io *io, app_io_fn ready, struct app_task *task,
+		 void *data)
+{
+	assert(io != NULL);
+	assert(ready != NULL);
+	assert(task != NULL);
+
+	io->next = NULL;
+	io->ready = ready;
+	io->task = task;
+	io->data = data;
+}
+
+void app_io_wait(struct app_io *io)
+{
+	struct app_io *it;
+
+	for (it = io_list; it != NULL; it = it->next)
+		if (it == io)
+			return;
+
+	io->next = io_list;
+	io_list = io;
+}
+
+void app_io_cancel(struct app_io *io)
+{
+	struct app_io **it;
+
+	for (it = &io_list; *it != NULL; it = &(*it)->next) {
+		if (*it == io) {
+			*it = io->next;
+			io->next = NULL;
+			break;
+		}
+	}
+}
+
+int app_event_run(void)
+{
+	event_running = 1;
+	event_stat = 0;
+
+	while (event_running && !app_stop) {
+		struct app_task *task;
+		uint16_t sleep_ms;
+
+		/* cleared first so a task queued from now on is not missed */
+		event_flag = 0;
+
+		__disable_interrupt();
+		task = pop_task();
+		__enable_interrupt();
+
+		if (task != NULL) {
+			task->run(task);
+			continue;
+		}
+
+		if ((io_list != NULL) && poll_io())
+			continue;
+
+		sleep_ms = (io_list != NULL) ?
+			APP_EVENT_POLL_MS : APP_EVENT_IDLE_MS;
+		time_wait_flag(&event_flag, 1, TIME_MS_TO_TICKS(sleep_ms));
+	}
+
+	return event_stat;
+}
+
+void app_event_stop(int stat)
+{
+	event_running = 0;
+	event_stat = stat;
+}
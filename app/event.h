@@ -0,0 +1,105 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2014 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * app/event.h -- Application event loop
+ *
+ */
+
+#ifndef INCLUDE_APP_EVENT_H
+#define INCLUDE_APP_EVENT_H 1
+
+#include <stdint.h>
+#include "utils.h"
+
+/**
+   @file app/event.h
+
+   Cooperative run-to-completion event loop.  Tasks are queued and run one at
+   a time by app_event_run(): each one must return quickly and then queue a
+   task again, either straight away, after a delay or once some I/O has
+   completed.  Tasks can be queued from interrupt handlers, for example in
+   I/O completion callbacks.  The devices which do not have a completion
+   interrupt are polled with struct app_io while the loop is idle.
+
+   Tasks and I/O events belong to the caller, which must cancel them before
+   their memory goes away.
+*/
+
+struct app_task;
+
+/** Task function, called from the event loop */
+typedef void (*app_task_fn)(struct app_task *task);
+
+/** Task which can be queued to run once from the event loop */
+struct app_task {
+	struct app_task *next;
+	app_task_fn run;
+	void *data;			/**< for the task function */
+	struct time_timer timer;	/**< for app_task_post_delayed() */
+	volatile uint8_t queued;
+};
+
+struct app_io;
+
+/** Poll function, return non-zero when the I/O has completed */
+typedef int (*app_io_fn)(struct app_io *io);
+
+/** Polled I/O completion */
+struct app_io {
+	struct app_io *next;
+	app_io_fn ready;
+	struct app_task *task;		/**< queued when ready() returns 1 */
+	void *data;			/**< for the poll function */
+};
+
+/** Time between two polls of the pending I/O events, in ms */
+#define APP_EVENT_POLL_MS 5
+
+/** Initialise a task */
+extern void app_task_init(struct app_task *task, app_task_fn run, void *data);
+
+/** Queue a task to run once, ignored if it is already queued.  This can be
+ * called from an interrupt handler. */
+extern void app_task_post(struct app_task *task);
+
+/** Queue a task to run once after ms milliseconds, using the time base */
+extern void app_task_post_delayed(struct app_task *task, uint16_t ms);
+
+/** Remove a task from the queue and cancel its delay if pending */
+extern void app_task_cancel(struct app_task *task);
+
+/** Initialise a polled I/O event, task is queued once it has completed */
+extern void app_io_init(struct app_io *io, app_io_fn ready,
+			struct app_task *task, void *data);
+
+/** Start polling an I/O event until it has completed */
+extern void app_io_wait(struct app_io *io);
+
+/** Stop polling an I/O event */
+extern void app_io_cancel(struct app_io *io);
+
+/** Run the queued tasks until app_event_stop() is called or app_stop is set,
+ * sleeping while there is nothing to do.  Return the app_event_stop()
+ * status. */
+extern int app_event_run(void);
+
+/** Make app_event_run() return stat once the current task has returned */
+extern void app_event_stop(int stat);
+
+#endif /* INCLUDE_APP_EVENT_H */
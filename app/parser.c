@@ -118,27 +118,56 @@ int parser_read_area(const char *str, const char *sep, struct pl_area *a)
 	return parser_read_int_list(str, sep, coords);
 }
 
-int parser_read_file_line(FIL *f, char *buffer, int max_length)
+void parser_file_init(struct parser_file *pf, FIL *f)
 {
-	size_t count;
-	char *out;
-	int i;
+	pf->f = f;
+	pf->pos = 0;
+	pf->len = 0;
+}
 
-	for (i = 0, out = buffer; i < max_length; ++i, ++out) {
-		if (f_read(f, out, 1, &count) != FR_OK)
-			return -1;
+int parser_file_rewind(struct parser_file *pf)
+{
+	pf->pos = 0;
+	pf->len = 0;
+
+	return (f_lseek(pf->f, 0) == FR_OK) ? 0 : -1;
+}
+
+int parser_read_file_line(struct parser_file *pf, char *buffer, int max_length)
+{
+	int consumed = 0;
+	int len = 0;
+
+	for (;;) {
+		char c;
+
+		if (pf->pos == pf->len) {
+			if (f_read(pf->f, pf->buf, sizeof(pf->buf), &pf->len)
+			    != FR_OK)
+				return -1;
 
-		if ((*out == '\n') || !count)
+			pf->pos = 0;
+
+			if (!pf->len)
+				break;
+		}
+
+		c = pf->buf[pf->pos++];
+		++consumed;
+
+		if (c == '\n')
 			break;
 
-		if (*out == '\r')
-			--out;
-	}
+		if (c == '\r')
+			continue;
 
-	if (i == max_length)
-		return -1;
+		if (len == (max_length - 1))
+			return -1;
+
+		buffer[len++] = c;
+	}
 
-	*out = '\0';
+	buffer[len] = '\0';
 
-	return !!count;
+	return consumed ? 1 : 0;
 }
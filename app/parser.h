@@ -31,6 +31,17 @@
 
 struct pl_area;
 
+/* Size of the read buffer, one sector so refills go straight to the card */
+#define PARSER_FILE_BUFFER_LENGTH 512
+
+/** Buffered reader used to read text files line by line */
+struct parser_file {
+	FIL *f;
+	UINT pos;
+	UINT len;
+	char buf[PARSER_FILE_BUFFER_LENGTH];
+};
+
 /** Return the offset of the first occurence of any sep characters in str if
  * skip=0, or the first occurence of any character not in sep if skip=1 */
 extern int parser_find_str(const char *str, const char *sep, int skip);
@@ -53,9 +64,16 @@ extern int parser_read_word(const char *str, const char *sep, unsigned int *out)
 extern int parser_read_area(const char *str, const char *sep,
 			    struct pl_area *area);
 
+/** Attach a buffered reader to an open file */
+extern void parser_file_init(struct parser_file *pf, FIL *f);
+
+/** Go back to the start of the file and drop the buffered data */
+extern int parser_file_rewind(struct parser_file *pf);
+
 /** Read one line worth of data from a text file
  *  Return 1 if some data was read, 0 if end of file reached and no data was
  *  read but no error occured and -1 if an error occured.  */
-extern int parser_read_file_line(FIL *f, char *buffer, int max_length);
+extern int parser_read_file_line(struct parser_file *pf, char *buffer,
+				 int max_length);
 
 #endif /* INCLUDE_APP_PARSER_H */
@@ -50,10 +50,10 @@ int app_pattern(struct pl_platform *plat)
 	if (epdc->pattern_check(epdc, CONFIG_DEMO_PATTERN_SIZE))
 		return -1;
 
-	if (epdc->update_temp(epdc))
+	if (pl_epdc_update_temp(epdc))
 		return -1;
 
-	if (psu->on(psu))
+	if (pl_epdpsu_on(psu))
 		return -1;
 
 	if (epdc->update(epdc, wfid, UPDATE_FULL, NULL))
@@ -62,7 +62,7 @@ int app_pattern(struct pl_platform *plat)
 	if (epdc->wait_update_end(epdc))
 		return -1;
 
-	if (psu->off(psu))
+	if (pl_epdpsu_off(psu))
 		return -1;
 
 	return 0;
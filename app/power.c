@@ -28,6 +28,8 @@
 #include <app/app.h>
 #include <pl/platform.h>
 #include <pl/epdc.h>
+#include <pl/energy.h>
+#include <pl/epdpsu.h>
 #include <string.h>
 
 #define LOG_TAG "power-demo"
@@ -90,6 +92,11 @@ int app_power(struct pl_platform *plat, const char *path)
 
 		LOG("SLEEP");
 
+		/* the event loop is not running to end the PSU keep-alive,
+		 * turn the PSU off before each low power state */
+		if (pl_epdpsu_flush(psu))
+			return -1;
+
 		if (epdc->set_power(epdc, PL_EPDC_SLEEP))
 			return -1;
 
@@ -99,6 +106,9 @@ int app_power(struct pl_platform *plat, const char *path)
 
 		LOG("STANDBY");
 
+		if (pl_epdpsu_flush(psu))
+			return -1;
+
 		if (epdc->set_power(epdc, PL_EPDC_STANDBY))
 			return -1;
 
@@ -118,6 +128,9 @@ int app_power(struct pl_platform *plat, const char *path)
 
 		LOG("OFF");
 
+		if (pl_epdpsu_flush(psu))
+			return -1;
+
 		if (epdc->set_power(epdc, PL_EPDC_OFF))
 			return -1;
 
@@ -132,6 +145,7 @@ int app_power(struct pl_platform *plat, const char *path)
 			return -1;
 
 		msleep(1000);
+		pl_energy_log();
 	}
 
 	return 0;
@@ -0,0 +1,311 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2014 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * app/radio-image.c -- Image transfer over BasicRF
+ *
+ */
+
+#include <app/app.h>
+#include <app/event.h>
+#include <app/radio.h>
+#include <app/radio-image.h>
+#include <pl/platform.h>
+#include <pl/epdc.h>
+#include <pl/epdpsu.h>
+#include <pl/types.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "crc16.h"
+
+#define LOG_TAG "radio-image"
+#include "utils.h"
+
+/** Receiver state, the radio handler has no context so there is only one */
+struct radio_image {
+	struct pl_platform *plat;
+	struct app_task task;		/**< ends the update */
+	struct app_io update_io;
+	struct pl_area area;
+	uint32_t start_us;		/**< pl_time_now_us() at START */
+	uint32_t size;			/**< pixel data bytes expected */
+	uint32_t received;		/**< pixel data bytes loaded so far */
+	uint16_t seq;			/**< next DATA chunk expected */
+	uint16_t crc;
+	int wfid;
+	uint8_t id;
+	uint8_t loading;		/**< EPDC image load in progress */
+	uint8_t updating;		/**< update running, EPD PSU on */
+};
+
+static struct radio_image radio_image;
+
+static uint16_t get_le16(const uint8_t *data)
+{
+	return data[0] | (data[1] << 8);
+}
+
+/* Close the EPDC image load, the partial data is never shown */
+static int radio_image_abort(struct radio_image *rx)
+{
+	struct pl_epdc *epdc = &rx->plat->epdc;
+
+	LOG("Image %u aborted", rx->id);
+	rx->loading = 0;
+
+	return epdc->load_image_end(epdc);
+}
+
+static int radio_image_update_end(struct radio_image *rx)
+{
+	struct pl_platform *plat = rx->plat;
+
+	app_io_cancel(&rx->update_io);
+	rx->updating = 0;
+
+	if (plat->epdc.wait_update_end(&plat->epdc))
+		return -1;
+
+	/* turned off later with the keep-alive */
+	return pl_epdpsu_off(&plat->psu);
+}
+
+static int radio_image_start(struct radio_image *rx, const uint8_t *data,
+			     uint8_t len)
+{
+	struct pl_epdc *epdc = &rx->plat->epdc;
+	struct pl_area area;
+	int wfid;
+
+	if (len < RADIO_IMAGE_START_LEN) {
+		LOG("Invalid START message");
+		return 0;
+	}
+
+	if (rx->loading && radio_image_abort(rx))
+		return -1;
+
+	if (rx->updating && radio_image_update_end(rx))
+		return -1;
+
+	area.left = get_le16(&data[4]);
+	area.top = get_le16(&data[6]);
+	area.width = get_le16(&data[8]);
+	area.height = get_le16(&data[10]);
+
+	if (!area.width || !area.height ||
+	    ((unsigned)(area.left + area.width) > epdc->xres) ||
+	    ((unsigned)(area.top + area.height) > epdc->yres)) {
+		LOG("Invalid area: (%d, %d) %dx%d", area.left, area.top,
+		    area.width, area.height);
+		return 0;
+	}
+
+	wfid = pl_epdc_get_wfid(epdc, data[2]);
+
+	if (wfid < 0) {
+		LOG("Invalid waveform id: %u", data[2]);
+		return 0;
+	}
+
+	/* convert the temperature while the image is being received */
+	if (pl_epdc_start_temp(epdc))
+		return -1;
+
+	if (epdc->load_image_begin(epdc, &area))
+		return -1;
+
+	rx->id = data[1];
+	rx->wfid = wfid;
+	rx->area = area;
+	rx->size = ((uint32_t)area.width * area.height + 1) & ~1UL;
+	rx->received = 0;
+	rx->seq = 0;
+	rx->crc = crc16_init;
+	rx->start_us = pl_time_now_us();
+	rx->loading = 1;
+
+	return 0;
+}
+
+static int radio_image_data(struct radio_image *rx, const uint8_t *data,
+			    uint8_t len)
+{
+	struct pl_epdc *epdc = &rx->plat->epdc;
+	const uint8_t *pixels = &data[RADIO_IMAGE_DATA_LEN];
+	uint8_t n;
+	uint16_t seq;
+
+	if ((len < RADIO_IMAGE_DATA_LEN) || !rx->loading ||
+	    (data[1] != rx->id))
+		return 0;
+
+	n = len - RADIO_IMAGE_DATA_LEN;
+	seq = get_le16(&data[2]);
+
+	/* sent again as the acknowledgement was lost */
+	if (seq < rx->seq)
+		return 0;
+
+	if (seq > rx->seq) {
+		LOG("Missing chunk %u", rx->seq);
+		return radio_image_abort(rx);
+	}
+
+	if ((n & 1) || ((rx->received + n) > rx->size)) {
+		LOG("Invalid chunk %u", seq);
+		return radio_image_abort(rx);
+	}
+
+	if (epdc->load_image_data(epdc, pixels, n))
+		return -1;
+
+	rx->crc = crc16_run(rx->crc, pixels, n);
+	rx->received += n;
+	++rx->seq;
+
+	return 0;
+}
+
+static int radio_image_end(struct radio_image *rx, const uint8_t *data,
+			   uint8_t len, int16_t rssi)
+{
+	struct pl_platform *plat = rx->plat;
+	struct pl_epdc *epdc = &plat->epdc;
+	uint16_t chunks;
+	uint16_t crc;
+
+	if ((len < RADIO_IMAGE_END_LEN) || !rx->loading ||
+	    (data[1] != rx->id))
+		return 0;
+
+	chunks = get_le16(&data[2]);
+	crc = get_le16(&data[4]);
+	rx->loading = 0;
+
+	if (epdc->load_image_end(epdc))
+		return -1;
+
+	if ((chunks != rx->seq) || (rx->received != rx->size) ||
+	    (crc != rx->crc)) {
+		LOG("Image %u rejected: %u/%u chunks, %lu/%lu bytes, "
+		    "CRC 0x%04X/0x%04X", rx->id, rx->seq, chunks,
+		    rx->received, rx->size, rx->crc, crc);
+		return 0;
+	}
+
+	LOG("Image %u: %lu bytes in %lu ms, RSSI %d", rx->id, rx->size,
+	    (pl_time_since(rx->start_us) / 1000), rssi);
+
+	if (pl_epdc_update_temp(epdc))
+		return -1;
+
+	if (pl_epdpsu_on(&plat->psu))
+		return -1;
+
+	if (epdc->update(epdc, rx->wfid, UPDATE_PARTIAL_AREA, &rx->area))
+		return -1;
+
+	rx->updating = 1;
+	app_io_wait(&rx->update_io);
+
+	return 0;
+}
+
+static void radio_image_receive(const uint8_t *data, uint8_t len,
+				int16_t rssi)
+{
+	struct radio_image *rx = &radio_image;
+	int stat;
+
+	if (!len)
+		return;
+
+	switch (data[0]) {
+	case RADIO_IMAGE_START:
+		stat = radio_image_start(rx, data, len);
+		break;
+	case RADIO_IMAGE_DATA:
+		stat = radio_image_data(rx, data, len);
+		break;
+	case RADIO_IMAGE_END:
+		stat = radio_image_end(rx, data, len, rssi);
+		break;
+	default:
+		LOG("Invalid message type: %u", data[0]);
+		stat = 0;
+		break;
+	}
+
+	if (stat) {
+		LOG("EPDC error");
+		app_event_stop(-1);
+	}
+}
+
+static int update_done(struct app_io *io)
+{
+	return pl_epdc_update_done(io->data);
+}
+
+static void radio_image_run(struct app_task *task)
+{
+	struct radio_image *rx = task->data;
+
+	if (rx->updating && radio_image_update_end(rx))
+		app_event_stop(-1);
+}
+
+int app_radio_image(struct pl_platform *plat)
+{
+	struct radio_image *rx = &radio_image;
+	struct pl_epdc *epdc = &plat->epdc;
+	int stat;
+
+	if ((epdc->load_image_begin == NULL) ||
+	    (epdc->load_image_data == NULL) ||
+	    (epdc->load_image_end == NULL)) {
+		LOG("Image streaming not supported by the EPDC");
+		return -1;
+	}
+
+	rx->plat = plat;
+	rx->loading = 0;
+	rx->updating = 0;
+	app_task_init(&rx->task, radio_image_run, rx);
+	app_io_init(&rx->update_io, update_done, &rx->task, epdc);
+	app_radio_start(radio_image_receive);
+
+	LOG("Waiting for images");
+	stat = app_event_run();
+
+	app_radio_start(NULL);
+	app_io_cancel(&rx->update_io);
+	app_task_cancel(&rx->task);
+
+	if (rx->loading && radio_image_abort(rx))
+		stat = -1;
+
+	if (rx->updating && radio_image_update_end(rx))
+		stat = -1;
+
+	if (pl_epdpsu_flush(&plat->psu))
+		stat = -1;
+
+	return stat;
+}
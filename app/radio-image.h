@@ -0,0 +1,76 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2014 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * app/radio-image.h -- Image transfer over BasicRF
+ *
+ */
+
+#ifndef INCLUDE_APP_RADIO_IMAGE_H
+#define INCLUDE_APP_RADIO_IMAGE_H 1
+
+#include <app/radio.h>
+
+/**
+   @file app/radio-image.h
+
+   Images are pushed by a sender as a START message, DATA chunks in sequence
+   and an END message, each one in its own BasicRF packet.  The pixel data
+   goes straight to the EPDC image buffer as it is received, and the area is
+   shown with a partial update once the END message has been checked.
+   Nothing is buffered on the receiver side, so a missing chunk aborts the
+   transfer and the sender has to start again with a new START message.
+
+   BasicRF only holds one received packet, so the sender needs to leave at
+   least RADIO_IMAGE_PACKET_GAP_MS between two packets.  A START message
+   sent while the previous image is still being updated waits for the end
+   of the update, so the sender should also wait for the update to end.
+
+   All the fields are little-endian:
+
+   - START: type, id, wfid, 0, left (16), top (16), width (16), height (16)
+   - DATA: type, id, seq (16), up to RADIO_IMAGE_CHUNK bytes of pixel data
+   - END: type, id, number of DATA chunks (16), CRC (16)
+
+   The pixel data is the area in 8 bits per pixel, one line after the other,
+   padded to an even number of bytes.  Each DATA chunk has an even number of
+   bytes.  The CRC is calculated with crc16_run() over all the pixel data.
+   The id is chosen by the sender to tell consecutive images apart.
+
+   See tools/radio_image.py to produce the messages.
+*/
+
+/** Message types, first byte of each packet */
+enum radio_image_type {
+	RADIO_IMAGE_START = 0x01,
+	RADIO_IMAGE_DATA  = 0x02,
+	RADIO_IMAGE_END   = 0x03,
+};
+
+/** Message lengths, without the pixel data */
+#define RADIO_IMAGE_START_LEN 12
+#define RADIO_IMAGE_DATA_LEN 4
+#define RADIO_IMAGE_END_LEN 6
+
+/** Maximum number of pixel data bytes in a DATA message */
+#define RADIO_IMAGE_CHUNK (APP_RADIO_MAX_PAYLOAD - RADIO_IMAGE_DATA_LEN)
+
+/** Minimum time between two packets from the sender, in ms */
+#define RADIO_IMAGE_PACKET_GAP_MS 5
+
+#endif /* INCLUDE_APP_RADIO_IMAGE_H */
@@ -0,0 +1,99 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2014 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * app/radio.c -- BasicRF packet reception
+ *
+ */
+
+#include <app/event.h>
+#include <app/radio.h>
+#include <stdlib.h>
+#include "hal_rf.h"
+#include "basic_rf.h"
+
+#define LOG_TAG "radio"
+#include "utils.h"
+
+/* BasicRF only buffers one packet, which is received by its interrupt
+ * handler, so check regularly without keeping the event loop awake */
+#define RADIO_POLL_MS 20
+
+/* Check more often for a while after each packet, for packet streams, with
+ * the CPU kept at full speed rather than switching it at each poll */
+#define RADIO_BURST_POLL_MS 1
+#define RADIO_BURST_MS 250
+
+static struct app_task radio_task;
+static app_radio_handler_t radio_handler;
+static uint32_t radio_last_rx;
+static uint8_t radio_burst;
+
+static void radio_burst_end(void)
+{
+	if (radio_burst) {
+		radio_burst = 0;
+		cpu_busy_end();
+	}
+}
+
+static void radio_poll(struct app_task *task)
+{
+	uint8_t data[APP_RADIO_MAX_PAYLOAD];
+	int16_t rssi;
+	uint8_t len;
+
+	if (basicRfPacketIsReady()) {
+		len = basicRfReceive(data, sizeof(data), &rssi);
+		radio_last_rx = time_ticks();
+
+		if (!radio_burst) {
+			radio_burst = 1;
+			cpu_busy_begin();
+		}
+
+		if (radio_handler != NULL)
+			radio_handler(data, len, rssi);
+		else
+			LOG("%u bytes, RSSI %d", len, rssi);
+	}
+
+	if ((time_ticks() - radio_last_rx) < TIME_MS_TO_TICKS(RADIO_BURST_MS)) {
+		app_task_post_delayed(task, RADIO_BURST_POLL_MS);
+	} else {
+		radio_burst_end();
+		app_task_post_delayed(task, RADIO_POLL_MS);
+	}
+}
+
+void app_radio_start(app_radio_handler_t handler)
+{
+	app_task_cancel(&radio_task);
+	radio_burst_end();
+	radio_handler = handler;
+	radio_last_rx = time_ticks() - TIME_MS_TO_TICKS(RADIO_BURST_MS);
+	app_task_init(&radio_task, radio_poll, NULL);
+	app_task_post(&radio_task);
+}
+
+void app_radio_stop(void)
+{
+	app_task_cancel(&radio_task);
+	radio_burst_end();
+	radio_handler = NULL;
+}
@@ -0,0 +1,43 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2014 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * app/radio.h -- BasicRF packet reception
+ *
+ */
+
+#ifndef INCLUDE_APP_RADIO_H
+#define INCLUDE_APP_RADIO_H 1
+
+#include <stdint.h>
+
+/** Maximum BasicRF payload length without security */
+#define APP_RADIO_MAX_PAYLOAD 116
+
+/** Packet handler, called from the event loop */
+typedef void (*app_radio_handler_t)(const uint8_t *data, uint8_t len,
+				    int16_t rssi);
+
+/** Start receiving packets in the event loop, the packets are only logged
+ * when handler is NULL */
+extern void app_radio_start(app_radio_handler_t handler);
+
+/** Stop receiving packets */
+extern void app_radio_stop(void);
+
+#endif /* INCLUDE_APP_RADIO_H */
@@ -25,13 +25,17 @@
  */
 
 #include <app/app.h>
+#include <app/event.h>
 #include <app/parser.h>
 #include <pl/platform.h>
 #include <pl/epdc.h>
+#include <pl/energy.h>
 #include <pl/types.h>
 #include <stdlib.h>
 #include <string.h>
 #include "assert.h"
+#include "config.h"
+#include "trace.h"
 
 #define LOG_TAG "sequencer"
 #include "utils.h"
@@ -41,12 +45,37 @@
 
 /** Sequencer item with regions, waveform and timing information */
 struct sequencer_item {
-	char file[32];          /**< path to the image file to open */
+	char file[32];          /**< image file to open, or pack.pak:index */
 	struct pl_area area;    /**< area coordinates on the display */
 	int left_in;            /**< left coordinate to start reading from */
 	int top_in;             /**< top coordinate to start reading from */
 };
 
+struct sequencer;
+
+/** Script command */
+struct sequencer_cmd {
+	const char *name;
+	int (*func)(struct sequencer *seq, const char *str);
+};
+
+/** Sequencer state, each command is run as a separate event loop task */
+struct sequencer {
+	struct pl_platform *plat;
+	struct app_task task;
+	struct app_io update_io;
+	FIL slides;
+	struct parser_file script;
+	unsigned long lno;
+	uint16_t delay_ms;	/**< wait before running the next command */
+	uint8_t power_off;	/**< turn the power off once the update ends */
+	uint8_t priority;	/**< enum pl_update_priority for the updates */
+	uint8_t send_queue;	/**< send the queued updates before going on */
+	const struct sequencer_cmd *cmd; /**< to run once they have been sent */
+	char line[81];		/**< current script line */
+	int args;		/**< offset of the command arguments in line */
+};
+
 static const char SEP[] = ", ";
 
 /* -- private functions -- */
@@ -54,94 +83,65 @@ static const char SEP[] = ", ";
 static int load_image(struct pl_epdc *epdc, const struct sequencer_item *item,
 		      const char *dir);
 static int parse_item(const char *line, struct sequencer_item *item);
-static int cmd_sleep(struct pl_platform *plat, const char *line);
-static int cmd_image(struct pl_platform *plat, const char *line);
-static int cmd_fill(struct pl_platform *plat, const char *line);
-static int cmd_power(struct pl_platform *plat, const char *line);
-static int cmd_update(struct pl_platform *plat, const char *line);
+static int update_done(struct app_io *io);
+static int send_queue(struct sequencer *seq);
+static int run_next_cmd(struct sequencer *seq);
+static void sequencer_run(struct app_task *task);
+static int cmd_sleep(struct sequencer *seq, const char *line);
+static int cmd_image(struct sequencer *seq, const char *line);
+static int cmd_fill(struct sequencer *seq, const char *line);
+static int cmd_power(struct sequencer *seq, const char *line);
+static int cmd_update(struct sequencer *seq, const char *line);
+static int cmd_priority(struct sequencer *seq, const char *line);
 
 /* -- public entry point -- */
 
 int app_sequencer(struct pl_platform *plat, const char *path)
 {
-	FIL slides;
-	int stat, i;
-	unsigned long lno;
+	struct sequencer seq;
+	int stat;
 
 	LOG("Running sequence from %s", path);
 
-	if (f_open(&slides, path, FA_READ) != FR_OK) {
+	if (f_open(&seq.slides, path, FA_READ) != FR_OK) {
 		LOG("Failed to open slideshow text file [%s]", path);
 		return -1;
 	}
 
-	stat = 0;
-	lno = 0;
-
-	while (!stat) {
-		struct cmd {
-			const char *name;
-			int (*func)(struct pl_platform *plat, const char *str);
-		};
-		static const struct cmd cmd_table[] = {
-			{ "update", cmd_update },
-			{ "power", cmd_power },
-			{ "fill", cmd_fill },
-			{ "image", cmd_image },
-			{ "sleep", cmd_sleep },
-			{ NULL, NULL }
-		};
-		const struct cmd *cmd;
-		char line[81];
-		char cmd_name[16];
-		int len;
-
-		++lno;
-		stat = parser_read_file_line(&slides, line, 81);
-
-		if (stat < 0) {
-			LOG("Failed to read line");
-			break;
-		}
-		for(i=0;i<81;i++){
-			if(line[i] < 0x19) break;
-			LOG("%c", line[i]);
-		}
-		LOG("-----------------------");
-		if (!stat) {
-			f_lseek(&slides, 0);
-			lno = 0;
-			continue;
-		}
-
-		stat = 0;
-
-		if ((line[0] == '\0') || (line[0] == '#'))
-			continue;
-
-		len = parser_read_str(line, SEP, cmd_name, sizeof(cmd_name));
-
-		if (len < 0) {
-			LOG("Failed to read command");
+	parser_file_init(&seq.script, &seq.slides);
+	seq.plat = plat;
+	seq.lno = 0;
+	seq.delay_ms = 0;
+	seq.power_off = 0;
+	seq.priority = PL_UPDATE_PRIO_NORMAL;
+	seq.send_queue = 0;
+	seq.cmd = NULL;
+	app_task_init(&seq.task, sequencer_run, &seq);
+	app_io_init(&seq.update_io, update_done, &seq.task, &plat->epdc);
+	app_task_post(&seq.task);
+
+	stat = app_event_run();
+
+	app_io_cancel(&seq.update_io);
+	app_task_cancel(&seq.task);
+
+	if (pl_epdc_queue_flush(&plat->epdc))
+		stat = -1;
+
+	/* stopped while waiting for the end of an update */
+	if (seq.power_off) {
+		if (plat->epdc.wait_update_end(&plat->epdc) ||
+		    pl_epdpsu_off(&plat->psu))
 			stat = -1;
-			break;
-		}
+	}
 
-		for (cmd = cmd_table; cmd->name != NULL; ++cmd) {
-			if (!strcmp(cmd->name, cmd_name)) {
-				stat = cmd->func(plat, (line + len));
-				break;
-			}
-		}
+	if (pl_epdpsu_flush(&plat->psu))
+		stat = -1;
 
-		if (cmd->name == NULL) {
-			LOG("Invalid command");
-			stat = -1;
-			break;
-		}
-	}
+	pl_energy_log();
+	pl_epdc_queue_log(&plat->epdc);
 
-	f_close(&slides);
+	f_close(&seq.slides);
 
 	return stat;
 }
@@ -210,10 +210,157 @@ exit_now:
 	return -1;
 }
 
-static int cmd_update(struct pl_platform *plat, const char *line)
+static int update_done(struct app_io *io)
+{
+	return pl_epdc_update_done(io->data);
+}
+
+/* Send the queued updates without waiting, return 1 if one is held until the
+ * end of the running update or 0 once they have all been sent */
+static int send_queue(struct sequencer *seq)
+{
+	struct pl_epdc *epdc = &seq->plat->epdc;
+	int stat;
+
+	do {
+		stat = pl_epdc_queue_run(epdc);
+	} while (stat > 0);
+
+	if (stat < 0)
+		return -1;
+
+	if (epdc->queue.n)
+		return 1;
+
+	seq->send_queue = 0;
+
+	return 0;
+}
+
+/* Read the next line of the script and run its command, rewinding at the end
+ * of the file */
+static int run_next_cmd(struct sequencer *seq)
+{
+	static const struct sequencer_cmd cmd_table[] = {
+		{ "update", cmd_update },
+		{ "power", cmd_power },
+		{ "fill", cmd_fill },
+		{ "image", cmd_image },
+		{ "sleep", cmd_sleep },
+		{ "priority", cmd_priority },
+		{ NULL, NULL }
+	};
+	const struct sequencer_cmd *cmd;
+	char *line = seq->line;
+	char cmd_name[16];
+	int stat, len, i;
+
+	++seq->lno;
+	stat = parser_read_file_line(&seq->script, line, sizeof(seq->line));
+
+	if (stat < 0) {
+		LOG("Failed to read line");
+		return -1;
+	}
+	for(i=0;i<sizeof(seq->line);i++){
+		if(line[i] < 0x19) break;
+		LOG("%c", line[i]);
+	}
+	LOG("-----------------------");
+	if (!stat) {
+#if CONFIG_DISK_CACHE_STATS
+		log_disk_cache_stats();
+#endif
+		if (parser_file_rewind(&seq->script)) {
+			LOG("Failed to rewind sequence file");
+			return -1;
+		}
+
+		seq->lno = 0;
+		return 0;
+	}
+
+	if ((line[0] == '\0') || (line[0] == '#'))
+		return 0;
+
+	len = parser_read_str(line, SEP, cmd_name, sizeof(cmd_name));
+
+	if (len < 0) {
+		LOG("Failed to read command");
+		return -1;
+	}
+
+	for (cmd = cmd_table; cmd->name != NULL; ++cmd) {
+		if (strcmp(cmd->name, cmd_name))
+			continue;
+
+		/* consecutive updates are queued, send them before anything
+		 * else changes the image data or the power */
+		if ((cmd->func != cmd_update) && (cmd->func != cmd_priority) &&
+		    seq->plat->epdc.queue.n) {
+			seq->send_queue = 1;
+			seq->cmd = cmd;
+			seq->args = len;
+			return 0;
+		}
+
+		return cmd->func(seq, (line + len));
+	}
+
+	LOG("Invalid command");
+
+	return -1;
+}
+
+static void sequencer_run(struct app_task *task)
+{
+	struct sequencer *seq = task->data;
+	struct pl_platform *plat = seq->plat;
+	int stat;
+
+	if (seq->power_off) {
+		/* the update has now ended */
+		seq->power_off = 0;
+
+		if (plat->epdc.wait_update_end(&plat->epdc) ||
+		    pl_epdpsu_off(&plat->psu)) {
+			app_event_stop(-1);
+			return;
+		}
+	}
+
+	if (seq->send_queue) {
+		stat = send_queue(seq);
+	} else if (seq->cmd != NULL) {
+		const struct sequencer_cmd *cmd = seq->cmd;
+
+		seq->cmd = NULL;
+		stat = cmd->func(seq, (seq->line + seq->args));
+	} else {
+		stat = run_next_cmd(seq);
+	}
+
+	if (stat < 0) {
+		LOG("Failed to run command, line %lu", seq->lno);
+		app_event_stop(-1);
+		return;
+	}
+
+	if (seq->power_off || (stat > 0)) {
+		/* the update has to end first */
+		app_io_wait(&seq->update_io);
+	} else if (seq->send_queue || (seq->cmd != NULL)) {
+		app_task_post(task);
+	} else {
+		app_task_post_delayed(task, seq->delay_ms);
+		seq->delay_ms = 0;
+	}
+}
+
+static int cmd_update(struct sequencer *seq, const char *line)
 {
 	// update structure: update, wfid, update_mode, area->left, area->top, area->width, area->height,delay_ms
-	struct pl_epdc *epdc = &plat->epdc;
+	struct pl_epdc *epdc = &seq->plat->epdc;
 	//char waveform[16];
 	//char update_mode[16];
 	enum pl_update_mode update_mode;
@@ -254,38 +401,61 @@ static int cmd_update(struct pl_platform *plat, const char *line)
 		return -1;
 	}
 
-	if (epdc->update(epdc,
-			pl_epdc_get_wfid(epdc, wfid),
-			update_mode,
-			&area))
+	if (pl_epdc_queue_update(epdc, pl_epdc_get_wfid(epdc, wfid),
+				 update_mode, &area, seq->priority))
 		return -1;
 
-	mdelay(delay_ms);
+	/* nothing else can be queued with it, the delay starts once it has
+	 * been sent */
+	if (delay_ms)
+		seq->send_queue = 1;
+
+	seq->delay_ms = delay_ms;
 
 	return stat;
 }
 
-static int cmd_power(struct pl_platform *plat, const char *line)
+static int cmd_priority(struct sequencer *seq, const char *line)
 {
-	struct pl_epdc *epdc = &plat->epdc;
-	struct pl_epdpsu *psu = &plat->psu;
+	static const char * const names[PL_UPDATE_N_PRIO] = {
+		"low", "normal", "high",
+	};
+	char name[8];
+	int i;
+
+	if (parser_read_str(line, SEP, name, sizeof(name)) < 0)
+		return -1;
+
+	for (i = 0; i < PL_UPDATE_N_PRIO; ++i) {
+		if (!strcmp(name, names[i])) {
+			seq->priority = i;
+			return 0;
+		}
+	}
+
+	LOG("Invalid priority: %s", name);
+
+	return -1;
+}
+
+static int cmd_power(struct sequencer *seq, const char *line)
+{
+	struct pl_epdc *epdc = &seq->plat->epdc;
+	struct pl_epdpsu *psu = &seq->plat->psu;
 	char on_off[4];
 
 	if (parser_read_str(line, SEP, on_off, sizeof(on_off)) < 0)
 		return -1;
 
 	if (!strcmp(on_off, "on")) {
-		if (epdc->update_temp(epdc))
+		if (pl_epdc_update_temp(epdc))
 			return -1;
 
-		if (psu->on(psu))
+		if (pl_epdpsu_on(psu))
 			return -1;
 	} else if (!strcmp(on_off, "off")) {
-		if (epdc->wait_update_end(epdc))
-			return -1;
-
-		if (psu->off(psu))
-			return -1;
+		/* done in sequencer_run() once the update has ended */
+		seq->power_off = 1;
 	} else {
 		LOG("Invalid on/off value: %s", on_off);
 		return -1;
@@ -294,9 +464,9 @@ static int cmd_power(struct pl_platform *plat, const char *line)
 	return 0;
 }
 
-static int cmd_fill(struct pl_platform *plat, const char *line)
+static int cmd_fill(struct sequencer *seq, const char *line)
 {
-	struct pl_epdc *epdc = &plat->epdc;
+	struct pl_epdc *epdc = &seq->plat->epdc;
 	struct pl_area area;
 	const char *opt;
 	int len;
@@ -322,21 +492,27 @@ static int cmd_fill(struct pl_platform *plat, const char *line)
 	return epdc->fill(epdc, &area, PL_GL16(gl));
 }
 
-static int cmd_image(struct pl_platform *plat, const char *line)
+static int cmd_image(struct sequencer *seq, const char *line)
 {
+	struct pl_epdc *epdc = &seq->plat->epdc;
 	struct sequencer_item item;
 
 	if (parse_item(line, &item))
 		return -1;
 
-	if (load_image(&plat->epdc, &item, "img"))
+	/* convert the temperature while the image is being loaded */
+	if (pl_epdc_start_temp(epdc))
+		return -1;
+
+	if (load_image(epdc, &item, "img"))
 		return -1;
 
 	return 0;
 }
 
-static int cmd_sleep(struct pl_platform *plat, const char *line)
+static int cmd_sleep(struct sequencer *seq, const char *line)
 {
+	struct pl_epdpsu *psu = &seq->plat->psu;
 	int sleep_ms;
 	int len;
 
@@ -350,7 +526,13 @@ static int cmd_sleep(struct pl_platform *plat, const char *line)
 		return -1;
 	}
 
-	msleep(sleep_ms);
+	/* don't keep the power on during sleeps longer than the keep-alive */
+	if ((unsigned)sleep_ms >= psu->keep_alive_ms) {
+		if (pl_epdpsu_flush(psu))
+			return -1;
+	}
+
+	seq->delay_ms = sleep_ms;
 
 	return 0;
 }
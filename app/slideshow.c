@@ -26,107 +26,382 @@
  */
 
 #include "app.h"
+#include "event.h"
 #include <pl/platform.h>
 #include <pl/epdc.h>
+#include <pl/energy.h>
 #include <pl/epdpsu.h>
 #include <stdio.h>
 #include <string.h>
 #include "assert.h"
+#include "config.h"
+#include "pnm-utils.h"
+#include "image-pack.h"
+#include "trace.h"
 
 #define LOG_TAG "slideshow"
 #include "utils.h"
 
+/* Number of bytes of pixel data read ahead while the previous slide is being
+ * displayed */
+#define SLIDESHOW_PREFETCH_LENGTH 1024
+
+/* Maximum number of images in the playlist index, the directory is walked on
+ * each slide change instead when there are more images than this.  Each
+ * entry takes 17 bytes of static RAM. */
+#define SLIDESHOW_INDEX_SIZE 64
+
+/* Steps to show an image, each one run as a separate event loop task */
+enum slideshow_state {
+	SLIDESHOW_LOAD,		/* load the image into the EPDC */
+	SLIDESHOW_UPDATE,	/* start the update */
+	SLIDESHOW_PREFETCH,	/* open the next image during the update */
+	SLIDESHOW_UPDATE_END,	/* turn the power off once the update has ended */
+};
+
+struct slideshow {
+	struct pl_platform *plat;
+	struct app_task task;
+	struct app_io update_io;
+	enum slideshow_state state;
+	const char *path;
+	DIR dir;
+	int dir_open;
+	struct pnm_file img;
+	int img_open;
+	uint8_t *prefetch;
+	struct pnm_ref *index;
+	unsigned index_len;
+	unsigned index_pos;
+	int indexed;
+	WORD fdate;
+	WORD ftime;
+};
+
 /* -- private functions -- */
 
-static int show_image(struct pl_platform *plat, const char *dir,
-		      const char *file);
+static int build_index(struct slideshow *s);
+static int index_changed(struct slideshow *s);
+static int read_next_name(struct slideshow *s, FILINFO *f);
+static int open_next_image(struct slideshow *s);
+static int update_done(struct app_io *io);
+static int show_image(struct slideshow *s);
+static void slideshow_run(struct app_task *task);
 
 /* -- public entry point -- */
 
 int app_slideshow(struct pl_platform *plat, const char *path)
 {
-	DIR dir;
-	FILINFO f;
-	int dir_open = 0;
+	static uint8_t prefetch[SLIDESHOW_PREFETCH_LENGTH];
+	static struct pnm_ref index[SLIDESHOW_INDEX_SIZE];
+	struct slideshow s;
+	int stat = 0;
 
 	assert(plat != NULL);
 	assert(path != NULL);
 
 	LOG("Running slideshow");
 
-	while (!app_stop) {
-		if (!dir_open) {
+	s.plat = plat;
+	s.path = path;
+	s.dir_open = 0;
+	s.img_open = 0;
+	s.prefetch = prefetch;
+	s.index = index;
+
+	if (build_index(&s))
+		return -1;
+
+	if (open_next_image(&s))
+		return -1;
+
+	s.state = SLIDESHOW_LOAD;
+	app_task_init(&s.task, slideshow_run, &s);
+	app_io_init(&s.update_io, update_done, &s.task, &plat->epdc);
+	app_task_post(&s.task);
+
+	stat = app_event_run();
+
+	app_io_cancel(&s.update_io);
+	app_task_cancel(&s.task);
+
+	/* stopped during an update */
+	if ((s.state == SLIDESHOW_PREFETCH) ||
+	    (s.state == SLIDESHOW_UPDATE_END)) {
+		if (plat->epdc.wait_update_end(&plat->epdc) ||
+		    pl_epdpsu_off(&plat->psu))
+			stat = -1;
+	}
+
+	if (s.img_open)
+		pnm_close(&s.img);
+
+	if (pl_epdpsu_flush(&plat->psu))
+		stat = -1;
+
+	pl_energy_log();
+
+	return stat;
+}
+
+/* Scan the directory once and record where the pixel data of each image is,
+ * including all the images in pack files, so it can be opened later without
+ * walking the directory again */
+static int build_index(struct slideshow *s)
+{
+	char path[MAX_PATH_LEN];
+	struct pnm_file img;
+	FILINFO f;
+	int stat;
+
+	s->index_len = 0;
+	s->index_pos = 0;
+	s->indexed = 0;
+
+	if (f_stat(s->path, &f) == FR_OK) {
+		s->fdate = f.fdate;
+		s->ftime = f.ftime;
+	} else {
+		/* root directory: no time stamp */
+		s->fdate = 0;
+		s->ftime = 0;
+	}
+
+	s->dir_open = 0;
+
+	while ((stat = read_next_name(s, &f)) == 0) {
+		const unsigned space = SLIDESHOW_INDEX_SIZE - s->index_len;
+		unsigned count = 1;
+
+		if (join_path(path, sizeof(path), s->path, f.fname))
+			return -1;
+
+		if (strstr(f.fname, ".PAK")) {
+			if (image_pack_index(path, &s->index[s->index_len],
+					     space, &count)) {
+				LOG("Failed to read image pack [%s]", path);
+				return -1;
+			}
+		} else if (space) {
+			if (pnm_open(&img, path, NULL, 0)) {
+				LOG("Failed to open image [%s]", path);
+				return -1;
+			}
+
+			pnm_get_ref(&img, &s->index[s->index_len]);
+			pnm_close(&img);
+		}
+
+		if (count > space) {
+			LOG("Too many images to index, walking the directory");
+			s->index_len = 0;
+			s->dir_open = 0;
+			return 0;
+		}
+
+		s->index_len += count;
+	}
+
+	if (stat < 0)
+		return -1;
+
+	if (!s->index_len) {
+		LOG("No image found in [%s]", s->path);
+		return -1;
+	}
+
+	LOG("%u images indexed", s->index_len);
+	s->indexed = 1;
+
+	return 0;
+}
+
+/* Check whether the directory time stamp has changed since the last scan */
+static int index_changed(struct slideshow *s)
+{
+	FILINFO f;
+
+	if (f_stat(s->path, &f) != FR_OK)
+		return 0;
+
+	return ((f.fdate != s->fdate) || (f.ftime != s->ftime));
+}
+
+/* Read the name of the next PGM or image pack file in the directory.  Returns
+ * 1 and closes the directory when the end is reached, or -1 on error. */
+static int read_next_name(struct slideshow *s, FILINFO *f)
+{
+	for (;;) {
+		if (!s->dir_open) {
 			/* (re-)open the directory */
-			if (f_opendir(&dir, path) != FR_OK) {
-				LOG("Failed to open directory [%s]", path);
+			if (f_opendir(&s->dir, s->path) != FR_OK) {
+				LOG("Failed to open directory [%s]", s->path);
 				return -1;
 			}
 
-			dir_open = 1;
+			s->dir_open = 1;
 		}
 
 		/* read next entry in the directory */
-		if (f_readdir(&dir, &f) != FR_OK) {
+		if (f_readdir(&s->dir, f) != FR_OK) {
 			LOG("Failed to read directory entry");
 			return -1;
 		}
 
 		/* end of the directory reached */
-		if (f.fname[0] == '\0') {
-			dir_open = 0;
-			continue;
+		if (f->fname[0] == '\0') {
+			s->dir_open = 0;
+			return 1;
 		}
 
 		/* skip directories */
-		if ((f.fname[0] == '.') || (f.fattrib & AM_DIR))
+		if ((f->fname[0] == '.') || (f->fattrib & AM_DIR))
 			continue;
 
-		/* only show PGM files */
-		if (!strstr(f.fname, ".PGM"))
-			continue;
+		/* only show PGM files and image packs */
+		if (strstr(f->fname, ".PGM") || strstr(f->fname, ".PAK"))
+			return 0;
+	}
+}
+
+/* Open the next image, rewinding at the end of the playlist, and read the
+ * start of its pixel data */
+static int open_next_image(struct slideshow *s)
+{
+	char path[MAX_PATH_LEN];
+	int rewind = 0;
+	FILINFO f;
+	int stat;
+
+	if (s->indexed) {
+		if (s->index_pos == s->index_len) {
+#if CONFIG_DISK_CACHE_STATS
+			log_disk_cache_stats();
+#endif
+			if (index_changed(s) && build_index(s))
+				return -1;
+
+			s->index_pos = 0;
+		}
+
+		if (s->indexed) {
+			const struct pnm_ref *ref = &s->index[s->index_pos++];
+
+			if (pnm_open_ref(&s->img, ref, s->prefetch,
+					 SLIDESHOW_PREFETCH_LENGTH)) {
+				LOG("Failed to open indexed image");
+				return -1;
+			}
+
+			s->img_open = 1;
+
+			return 0;
+		}
+	}
+
+	/* image packs are only shown when the directory is indexed */
+	while (((stat = read_next_name(s, &f)) != 0) ||
+	       !strstr(f.fname, ".PGM")) {
+		if (stat < 0)
+			return -1;
 
-		if (show_image(plat, path, f.fname)) {
-			LOG("Failed to show image");
+		/* stop if a whole pass did not find anything */
+		if (stat && rewind++) {
+			LOG("No image found in [%s]", s->path);
 			return -1;
 		}
 	}
 
+	if (join_path(path, sizeof(path), s->path, f.fname))
+		return -1;
+
+	if (pnm_open(&s->img, path, s->prefetch, SLIDESHOW_PREFETCH_LENGTH)) {
+		LOG("Failed to open image [%s]", path);
+		return -1;
+	}
+
+	s->img_open = 1;
+
 	return 0;
 }
 
-static int show_image(struct pl_platform *plat, const char *dir,
-		      const char *file)
+static int update_done(struct app_io *io)
 {
-	struct pl_epdc *epdc = &plat->epdc;
-	struct pl_epdpsu *psu = &plat->psu;
-	char path[MAX_PATH_LEN];
+	return pl_epdc_update_done(io->data);
+}
+
+/* Run the current step of showing an image, the next image is opened while
+ * the current one is being displayed */
+static int show_image(struct slideshow *s)
+{
+	struct pl_epdc *epdc = &s->plat->epdc;
+	struct pl_epdpsu *psu = &s->plat->psu;
 	int wfid;
 
-	wfid = pl_epdc_get_wfid(epdc, 2);
+	switch (s->state) {
+	case SLIDESHOW_LOAD:
+		/* convert the temperature while the image is being loaded */
+		if (pl_epdc_start_temp(epdc))
+			return -1;
 
-	if (wfid < 0)
-		return -1;
+		if (epdc->load_image_file(epdc, &s->img, NULL, 0, 0))
+			return -1;
 
-	if (join_path(path, sizeof(path), dir, file))
-		return -1;
+		pnm_close(&s->img);
+		s->img_open = 0;
+		s->state = SLIDESHOW_UPDATE;
+		app_task_post(&s->task);
+		break;
 
-	if (epdc->load_image(epdc, path, NULL, 0, 0))
-		return -1;
+	case SLIDESHOW_UPDATE:
+		wfid = pl_epdc_get_wfid(epdc, 2);
 
-	if (epdc->update_temp(epdc))
-		return -1;
+		if (wfid < 0)
+			return -1;
 
-	if (psu->on(psu))
-		return -1;
+		if (pl_epdc_update_temp(epdc))
+			return -1;
 
-	if (epdc->update(epdc, wfid, UPDATE_FULL, NULL))
-		return -1;
+		if (pl_epdpsu_on(psu))
+			return -1;
 
-	if (epdc->wait_update_end(epdc))
-		return -1;
+		if (epdc->update(epdc, wfid, UPDATE_FULL, NULL))
+			return -1;
 
-	if (psu->off(psu))
-		return -1;
+		s->state = SLIDESHOW_PREFETCH;
+		app_task_post(&s->task);
+		break;
+
+	case SLIDESHOW_PREFETCH:
+		/* read ahead while the waveform is running */
+		if (open_next_image(s))
+			return -1;
+
+		s->state = SLIDESHOW_UPDATE_END;
+		app_io_wait(&s->update_io);
+		break;
+
+	case SLIDESHOW_UPDATE_END:
+		if (epdc->wait_update_end(epdc))
+			return -1;
+
+		if (pl_epdpsu_off(psu))
+			return -1;
+
+		s->state = SLIDESHOW_LOAD;
+		app_task_post(&s->task);
+		break;
+	}
 
 	return 0;
 }
+
+static void slideshow_run(struct app_task *task)
+{
+	struct slideshow *s = task->data;
+
+	if (show_image(s)) {
+		LOG("Failed to show image");
+		app_event_stop(-1);
+	}
+}
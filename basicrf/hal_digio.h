@@ -60,6 +60,7 @@ uint8 halDigioIntEnable(const digioConfig *p);
 uint8 halDigioIntDisable(const digioConfig *p);
 uint8 halDigioIntClear(const digioConfig *p);
 uint8 halDigioIntSetEdge(const digioConfig *p, uint8 edge);
+uint8 halDigioIntDispatch(uint8 port, uint8 flags);
 
 
 #ifdef  __cplusplus
@@ -334,31 +334,39 @@ uint8 halDigioIntSetEdge(const digioConfig *p, uint8 edge)
 
 
 /***********************************************************************************
-* @fn      port2_ISR
+* @fn      halDigioIntDispatch
 *
-* @brief   ISR framework for P2 digio interrupt
+* @brief   Run the functions connected to the digio interrupts of a port.  The
+*          port ISRs are in msp430/msp430-gpio.c, which owns the vectors and
+*          clears the interrupt flags.
 *
-* @param   none
+* @param   uint8 port - port number (1 or 2)
+*          uint8 flags - pending and enabled interrupt flags of the port
 *
-* @return  none
+* @return  uint8 - bitmask of the flagged pins with a connected function
 */
-#pragma vector=PORT2_VECTOR
-__interrupt void port2_ISR(void)
+uint8 halDigioIntDispatch(uint8 port, uint8 flags)
 {
+    ISR_FUNC_PTR *tbl;
+    uint8 handled = 0;
     register uint8 i;
-    if (P2IFG)
+
+    switch (port)
+    {
+    case 1: tbl = port1_isr_tbl; break;
+    case 2: tbl = port2_isr_tbl; break;
+    default: return 0;
+    }
+
+    for (i = 0; flags; i++, flags >>= 1)
     {
-        for (i = 0; i < 8; i++)
+        if ((flags & 1) && (tbl[i] != 0))
         {
-            register const uint8 pinmask = 1 << i;
-            if ((P2IFG & pinmask) && (P2IE & pinmask) && (port2_isr_tbl[i] != 0))
-            {
-                (*port2_isr_tbl[i])();
-                P2IFG &= ~pinmask;
-            }
+            (*tbl[i])();
+            handled |= 1 << i;
         }
-        __low_power_mode_off_on_exit();
     }
+    return handled;
 }
 
 
@@ -24,10 +24,13 @@
  */
 #include "config.h"
 #include "app/parser.h"
+#include "crc16.h"
+#include "msp430-flash.h"
 #include <pl/types.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 #define LOG_TAG "config"
 #include "utils.h"
@@ -38,6 +41,33 @@
 struct config global_config;
 static const char SEP[] = " ";
 
+/* Binary snapshot of the configuration, stored in information memory so
+ * config.txt only needs to be parsed again when it has changed */
+#define CONFIG_SNAPSHOT_ADDR MSP430_FLASH_INFO_B
+#define CONFIG_SNAPSHOT_MAGIC 0x4643 /* "CF" */
+
+/* Firmware build, so a snapshot made by a build which may parse config.txt
+ * differently or use other default values is not used.  The parser and the
+ * default values are in this file and config.h, so it is rebuilt with them. */
+static const char config_build_id[] = __DATE__ " " __TIME__;
+
+struct config_snapshot {
+	uint16_t magic;
+	uint16_t version;
+	uint16_t build;		/* CRC of config_build_id */
+	DWORD fsize;		/* config.txt size and time stamp */
+	WORD fdate;
+	WORD ftime;
+	struct config config;
+	uint16_t crc;		/* CRC of all the fields above */
+};
+
+static int parse_config(char *configfile, struct config *config);
+
+/* config.txt size and time stamp, when read_config() succeeded */
+static FILINFO config_info;
+static int config_info_valid;
+
 enum endianess get_endianess(char* str){
 	if(strcmp(str, "CONFIG_BIG_ENDIAN") == 0)
 		return CONFIG_BIG_ENDIAN;
@@ -89,16 +119,101 @@ enum i2c_mode_id get_i2c_mode(char* str){
 		return I2C_MODE_NONE;
 };
 
+static uint16_t snapshot_crc(const struct config_snapshot *snapshot)
+{
+	return crc16_run(crc16_init, (const uint8_t *)snapshot,
+			 offsetof(struct config_snapshot, crc));
+}
+
+static uint16_t build_crc(void)
+{
+	return crc16_run(crc16_init, (const uint8_t *)config_build_id,
+			 (sizeof(config_build_id) - 1));
+}
+
+static int load_snapshot(const FILINFO *info, struct config *config)
+{
+	const struct config_snapshot *snapshot = CONFIG_SNAPSHOT_ADDR;
+
+	if ((snapshot->magic != CONFIG_SNAPSHOT_MAGIC) ||
+	    (snapshot->version != CONFIG_SNAPSHOT_VERSION) ||
+	    (snapshot->build != build_crc()) ||
+	    (snapshot->fsize != info->fsize) ||
+	    (snapshot->fdate != info->fdate) ||
+	    (snapshot->ftime != info->ftime) ||
+	    (snapshot->crc != snapshot_crc(snapshot)))
+		return -1;
+
+	memcpy(config, &snapshot->config, sizeof(struct config));
+
+	return 0;
+}
+
+static int save_snapshot(const FILINFO *info, const struct config *config)
+{
+	struct config_snapshot snapshot;
+
+	snapshot.magic = CONFIG_SNAPSHOT_MAGIC;
+	snapshot.version = CONFIG_SNAPSHOT_VERSION;
+	snapshot.build = build_crc();
+	snapshot.fsize = info->fsize;
+	snapshot.fdate = info->fdate;
+	snapshot.ftime = info->ftime;
+	memcpy(&snapshot.config, config, sizeof(struct config));
+	snapshot.crc = snapshot_crc(&snapshot);
+
+	return msp430_flash_write_info(CONFIG_SNAPSHOT_ADDR, &snapshot,
+				       sizeof(snapshot));
+}
+
 int read_config(char* configfile, struct config *config){
-	FIL cfg;
-	int stat = 0;
+	FILINFO info;
+	int stat;
+
 	if(config == NULL)
 		config = (struct config*) malloc(sizeof(struct config));
 
+	if (f_stat(configfile, &info) != FR_OK) {
+		LOG("Failed to find config text file [%s]", configfile);
+		return -1;
+	}
+
+	if (!load_snapshot(&info, config)) {
+		LOG("Using configuration snapshot");
+		stat = 0;
+	} else {
+		stat = parse_config(configfile, config);
+
+		if (!stat && save_snapshot(&info, config))
+			LOG("Failed to save configuration snapshot");
+	}
+
+	if (!stat) {
+		config_info = info;
+		config_info_valid = 1;
+	}
+
+	return stat;
+}
+
+int save_config(const struct config *config)
+{
+	if (!config_info_valid)
+		return -1;
+
+	return save_snapshot(&config_info, config);
+}
+
+static int parse_config(char *configfile, struct config *config){
+	FIL cfg;
+	struct parser_file reader;
+	int stat = 0;
+
 	if (f_open(&cfg, configfile, FA_READ) != FR_OK) {
 		LOG("Failed to open config text file [%s]", configfile);
 		return -1;
 	}
+	parser_file_init(&reader, &cfg);
 	char line[81];
 	int len = 0;
 	int lno = 0;
@@ -106,7 +221,7 @@ int read_config(char* configfile, struct config *config){
 	while(!stat){
 		++lno;
 
-		stat = parser_read_file_line(&cfg, line, sizeof(line));
+		stat = parser_read_file_line(&reader, line, sizeof(line));
 
 		if (stat < 0) {
 			LOG("Failed to read line");
@@ -212,6 +327,20 @@ int read_config(char* configfile, struct config *config){
 			len = parser_read_int(&line[len], SEP, &config->scrambling);
 		}else if(strcmp(config_name, "source_offset")==0){
 			len = parser_read_int(&line[len], SEP, &config->source_offset);
+		}else if(strcmp(config_name, "psu_keep_alive")==0){
+			len = parser_read_int(&line[len], SEP, &config->psu_keep_alive_ms);
+		}else if(strcmp(config_name, "psu_calibrate")==0){
+			len = parser_read_int(&line[len], SEP, &config->psu_calibrate);
+		}else if(strcmp(config_name, "psu_on_delay")==0){
+			len = parser_read_int(&line[len], SEP, &config->psu_on_delay_ms);
+		}else if(strcmp(config_name, "psu_off_delay")==0){
+			len = parser_read_int(&line[len], SEP, &config->psu_off_delay_ms);
+		}else if(strcmp(config_name, "pmic_temp")==0){
+			len = parser_read_int(&line[len], SEP, &config->pmic_temp);
+		}else if(strcmp(config_name, "i2c_host_speed")==0){
+			len = parser_read_int(&line[len], SEP, &config->i2c_host_khz);
+		}else if(strcmp(config_name, "i2c_disp_speed")==0){
+			len = parser_read_int(&line[len], SEP, &config->i2c_disp_khz);
 		}else if(strcmp(config_name, "interface_type")==0){
 			char interface_type[32];
 			len = parser_read_str(&line[len], SEP,interface_type, sizeof(interface_type));
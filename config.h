@@ -92,9 +92,29 @@ enum config_interface_type {
 #define CONFIG_DEMO_PATTERN           0  /** Not intended for Type19 displays  */
 #define CONFIG_DEMO_PATTERN_SIZE      16 /** Size of checker-board */
 
+/** Set to 1 to show the images received over BasicRF rather than the
+ * slideshow, see app/radio-image.h */
+#define CONFIG_DEMO_RADIO_IMAGE       0
+
 /** Set to 1 to have stdout, stderr sent to serial port */
 #define CONFIG_UART_PRINTF		0
 
+/** Set to 1 to record timing events and write them to trace.bin on the SD
+ * card when that file is present, see trace.h */
+#define CONFIG_TRACE			1
+
+/** Set to 1 to measure the time spent with the HV rails on and in each EPDC
+ * power state, see pl/energy.h */
+#define CONFIG_ENERGY			1
+
+/** Set to 1 to log the SD card sector cache hits and misses at the end of
+ * each slideshow or sequencer pass */
+#define CONFIG_DISK_CACHE_STATS		0
+
+/** Version of the configuration snapshot saved after parsing config.txt,
+ * increment it whenever struct config changes */
+#define CONFIG_SNAPSHOT_VERSION 5
+
 struct config {
 	enum config_interface_type interface_type;
 	enum endianess endianess; // most likely always little endian
@@ -106,10 +126,21 @@ struct config {
 	int source_offset;
 	int waveform_version;
 	int pmic_timings[8];
+	int psu_keep_alive_ms; //EPD PSU kept on after an update, 0 to disable
+	int psu_calibrate; //measure the EPD PSU delays if not known yet
+	int psu_on_delay_ms; //EPD PSU delays, 0 to use the default ones
+	int psu_off_delay_ms;
+	int pmic_temp; //use the HV-PMIC temperature sensor in manual mode
+	int i2c_host_khz; //MSP430 I2C bus SCL frequency, 0 to use the default
+	int i2c_disp_khz; //Epson I2C bus SCL frequency, 0 to use the default
 };
 
 extern struct config global_config;
 
 int read_config(char* configfile, struct config* config);
 
+/** Save the configuration snapshot again after changing values at run-time,
+ * such as calibration results, they are kept until config.txt changes */
+int save_config(const struct config *config);
+
 #endif /* INCLUDE_CONFIG_H */
@@ -28,6 +28,7 @@
 #include <epson/epson-epdc.h>
 #include <pl/types.h>
 #include <pl/epdc.h>
+#include <pl/energy.h>
 #include <pl/gpio.h>
 #include <stdlib.h>
 #include "assert.h"
@@ -47,15 +48,44 @@ static int epson_epdc_update(struct pl_epdc *epdc, int wfid,
 			    const struct pl_area *area)
 {
 	struct s1d135xx *p = epdc->data;
+	int stat;
+
+	pl_energy_update_begin(wfid, (epdc->temp_mode == PL_EPDC_TEMP_MANUAL) ?
+			       epdc->manual_temp : p->measured_temp);
+	stat = s1d135xx_update(p, wfid, mode, area);
+	pl_energy_update_sent();
 
-	return s1d135xx_update(p, wfid, mode, area);
+	return stat;
 }
 
 static int epson_epdc_wait_update_end(struct pl_epdc *epdc)
 {
 	struct s1d135xx *p = epdc->data;
+	int stat;
+
+	stat = s1d135xx_wait_update_end(p);
+	pl_energy_update_end();
+
+	if (!stat)
+		pl_epdc_queue_update_end(epdc);
+
+	return stat;
+}
+
+static int epson_epdc_update_done(struct pl_epdc *epdc)
+{
+	return s1d135xx_update_done(epdc->data);
+}
 
-	return s1d135xx_wait_update_end(p);
+static int epson_epdc_load_image_data(struct pl_epdc *epdc,
+				      const uint8_t *data, size_t n)
+{
+	return s1d135xx_load_image_data(epdc->data, data, n);
+}
+
+static int epson_epdc_load_image_end(struct pl_epdc *epdc)
+{
+	return s1d135xx_load_image_end(epdc->data);
 }
 
 static int epson_epdc_set_power(struct pl_epdc *epdc,
@@ -67,6 +97,7 @@ static int epson_epdc_set_power(struct pl_epdc *epdc,
 		return -1;
 
 	epdc->power_state = state;
+	pl_energy_power_state(state);
 
 	return 0;
 }
@@ -95,14 +126,22 @@ int epson_epdc_init(struct pl_epdc *epdc, const struct pl_dispinfo *dispinfo,
 		LOG("Using HDC GPIO");
 
 	s1d135xx->flags.needs_update = 0;
+	s1d135xx->flags.frend_sent = 0;
+	s1d135xx->int_bits = NULL;
+	s1d135xx->handlers = NULL;
 
 	epdc->clear_init = epson_epdc_clear_init;
 	epdc->update = epson_epdc_update;
 	epdc->wait_update_end = epson_epdc_wait_update_end;
+	epdc->update_done = epson_epdc_update_done;
+	epdc->load_image_data = epson_epdc_load_image_data;
+	epdc->load_image_end = epson_epdc_load_image_end;
 	epdc->set_power = epson_epdc_set_power;
 	epdc->set_epd_power = epson_epdc_set_epd_power;
 	epdc->data = s1d135xx;
 	epdc->dispinfo = dispinfo;
+	epdc->area_priority = 0;
+	pl_epdc_queue_reset(epdc);
 
 	switch (ref) {
 	case EPSON_EPDC_S1D13524:
@@ -125,6 +164,7 @@ int epson_epdc_init(struct pl_epdc *epdc, const struct pl_dispinfo *dispinfo,
 
 	s1d135xx->xres = epdc->xres;
 	s1d135xx->yres = epdc->yres;
+	pl_energy_power_state(epdc->power_state);
 
 	LOG("Ready %dx%d", epdc->xres, epdc->yres);
 
@@ -76,10 +76,30 @@ static int epson_s1d135xx_i2c_read(struct pl_i2c *i2c, uint8_t i2c_addr,
 static int epson_s1d135xx_i2c_write(struct pl_i2c *i2c, uint8_t i2c_addr,
 				    const uint8_t *data, uint8_t count,
 				    uint8_t flags);
+static int epson_s1d135xx_i2c_set_speed(struct pl_i2c *i2c, unsigned khz);
 static int s1d135xx_i2c_send_addr(struct s1d135xx *p, uint8_t i2c_addr,
 				  uint8_t read);
 static int s1d135xx_i2c_poll(struct s1d135xx *p, int check_nak);
 
+/* SCL frequency with the default I2C clock divider set by the EPDC init code */
+#define S1D13541_I2C_KHZ        100
+#define S1D13524_I2C_KHZ        400
+
+/* Maximum I2C clock divider value accepted by pl_i2c_set_speed() */
+#define I2C_CLOCK_DIV_MAX       0xFF
+
+/* Time to transfer 9 bits, used as the initial delay before checking whether
+ * a byte has been sent */
+#define I2C_BYTE_US(_khz)       ((9000 + (_khz) - 1) / (_khz))
+
+/* The delay is increased when the first check finds the bridge still busy,
+ * and decreased after this many bytes done on the first check */
+#define POLL_HITS_DEC           32
+#define POLL_MAX_US             1000
+
+/* Maximum time to wait for a byte, in us */
+#define POLL_TIMEOUT_US         10000
+
 /*
  *   Initialization of the I2C Module
  */
@@ -91,7 +111,13 @@ int epson_i2c_init(struct s1d135xx *p, struct pl_i2c *i2c,
 
 	i2c->read = epson_s1d135xx_i2c_read;
 	i2c->write = epson_s1d135xx_i2c_write;
+	i2c->set_speed = epson_s1d135xx_i2c_set_speed;
 	i2c->priv = p;
+	i2c->khz = (ref == EPSON_EPDC_S1D13524) ?
+		S1D13524_I2C_KHZ : S1D13541_I2C_KHZ;
+
+	p->i2c_poll_us = I2C_BYTE_US(i2c->khz);
+	p->i2c_poll_hits = 0;
 
 	return 0;
 }
@@ -136,15 +162,15 @@ static int epson_s1d135xx_i2c_write(struct pl_i2c *i2c, uint8_t i2c_addr,
 			return -1;
 
 	while (count--) {
-		uint8_t cmd;
+		uint16_t regs[4] = {
+			S1D135XX_I2C_REG_WD, *data++,
+			S1D135XX_I2C_REG_CMD, S1D135XX_I2C_CMD_GO,
+		};
 
 		if (!count && !(flags & PL_I2C_NO_STOP))
-			cmd = S1D135XX_I2C_CMD_GO | S1D135XX_I2C_CMD_GEN;
-		else
-			cmd = S1D135XX_I2C_CMD_GO;
+			regs[3] |= S1D135XX_I2C_CMD_GEN;
 
-		s1d135xx_write_reg(p, S1D135XX_I2C_REG_WD, *data++);
-		s1d135xx_write_reg(p, S1D135XX_I2C_REG_CMD, cmd);
+		s1d135xx_write_regs(p, regs, 2);
 
 		if (s1d135xx_i2c_poll(p, 1))
 			return -1;
@@ -153,32 +179,80 @@ static int epson_s1d135xx_i2c_write(struct pl_i2c *i2c, uint8_t i2c_addr,
 	return 0;
 }
 
+/* The SCL frequency is inversely proportional to the I2C clock divider + 1,
+ * so only the frequencies which are an exact multiple or fraction of the
+ * current one can be set.  The divider is kept in p->i2c_clock_div as the EPDC
+ * init code sets it again. */
+static int epson_s1d135xx_i2c_set_speed(struct pl_i2c *i2c, unsigned khz)
+{
+	struct s1d135xx *p = i2c->priv;
+	const unsigned long n = (p->i2c_clock_div + 1UL) * i2c->khz;
+
+	if (!khz || (n % khz) || ((n / khz) > (I2C_CLOCK_DIV_MAX + 1UL)))
+		return -1;
+
+	p->i2c_clock_div = (n / khz) - 1;
+	s1d135xx_write_reg(p, S1D135XX_REG_I2C_CLOCK, p->i2c_clock_div);
+	p->i2c_poll_us = I2C_BYTE_US(khz);
+	p->i2c_poll_hits = 0;
+
+	return 0;
+}
+
 static int s1d135xx_i2c_send_addr(struct s1d135xx *p, uint8_t i2c_addr,
 				  uint8_t read)
 {
-	s1d135xx_write_reg(p, S1D135XX_I2C_REG_WD, ((i2c_addr) << 1) | read);
-	s1d135xx_write_reg(p, S1D135XX_I2C_REG_CMD, (S1D135XX_I2C_CMD_START |
-						     S1D135XX_I2C_CMD_GEN |
-						     S1D135XX_I2C_CMD_GO));
+	const uint16_t regs[4] = {
+		S1D135XX_I2C_REG_WD, ((i2c_addr) << 1) | read,
+		S1D135XX_I2C_REG_CMD, (S1D135XX_I2C_CMD_START |
+				       S1D135XX_I2C_CMD_GEN |
+				       S1D135XX_I2C_CMD_GO),
+	};
+
+	s1d135xx_write_regs(p, regs, 2);
 
 	return s1d135xx_i2c_poll(p, 1);
 }
 
 static int s1d135xx_i2c_poll(struct s1d135xx *p, int check_nak)
 {
+	uint32_t start;
 	uint16_t status;
-	unsigned i = 0xFFFF;
+	int first = 1;
+
+	/* each status read is an SPI transaction, so only start reading once
+	 * the byte is likely to be done */
+	udelay(p->i2c_poll_us);
+	start = pl_time_now_us();
 
-	while (--i) {
+	for (;;) {
 		status = s1d135xx_read_reg(p, S1D135XX_I2C_REG_STAT);
 
 		if (!(status & S1D135XX_I2C_STAT_GO))
 			break;
+
+		if (first) {
+			first = 0;
+			p->i2c_poll_hits = 0;
+
+			if (p->i2c_poll_us < POLL_MAX_US)
+				p->i2c_poll_us += (p->i2c_poll_us / 8) + 1;
+		}
+
+		if (pl_time_since(start) >= POLL_TIMEOUT_US) {
+			LOG("TIMEOUT");
+			return -1;
+		}
+	}
+
+	if (first && (++p->i2c_poll_hits == POLL_HITS_DEC)) {
+		p->i2c_poll_hits = 0;
+
+		if (p->i2c_poll_us > 1)
+			--p->i2c_poll_us;
 	}
 
-	if (!i)
-		LOG("TIMEOUT");
-	else  if (status & S1D135XX_I2C_STAT_ERROR)
+	if (status & S1D135XX_I2C_STAT_ERROR)
 		LOG("ERROR");
 	else if (check_nak && (status & S1D135XX_I2C_STAT_RX_NAK))
 		LOG("NAK");
@@ -224,6 +224,23 @@ static int s1d13524_load_image(struct pl_epdc *epdc, const char *path,
 				   left, top);
 }
 
+static int s1d13524_load_image_begin(struct pl_epdc *epdc,
+				     const struct pl_area *area)
+{
+	struct s1d135xx *p = epdc->data;
+
+	return s1d135xx_load_image_begin(p, S1D13524_LD_IMG_8BPP, area);
+}
+
+static int s1d13524_load_image_file(struct pl_epdc *epdc, struct pnm_file *img,
+				    struct pl_area *area, int left, int top)
+{
+	struct s1d135xx *p = epdc->data;
+
+	return s1d135xx_load_image_file(p, img, S1D13524_LD_IMG_8BPP, 8, area,
+					left, top);
+}
+
 /* -- initialisation -- */
 
 int epson_epdc_early_init_s1d13524(struct s1d135xx *p)
@@ -280,6 +297,7 @@ int epson_epdc_init_s1d13524(struct pl_epdc *epdc)
 	if (s1d13524_init_ctlr_mode(p))
 		return -1;
 
+	epdc->area_priority = 1;
 	epdc->clear_init = s1d13524_clear_init;
 	epdc->load_wflib = s1d13524_load_wflib;
 	epdc->set_temp_mode = s1d13524_set_temp_mode;
@@ -287,6 +305,8 @@ int epson_epdc_init_s1d13524(struct pl_epdc *epdc)
 	epdc->fill = s1d13524_fill;
 	epdc->pattern_check = s1d13524_pattern_check;
 	epdc->load_image = s1d13524_load_image;
+	epdc->load_image_file = s1d13524_load_image_file;
+	epdc->load_image_begin = s1d13524_load_image_begin;
 	epdc->wf_table = epson_epdc_wf_table_s1d13524;
 	epdc->xres = s1d135xx_read_reg(p, S1D13524_REG_LINE_DATA_LENGTH);
 	epdc->yres = s1d135xx_read_reg(p, S1D13524_REG_FRAME_DATA_LENGTH);
@@ -332,7 +352,10 @@ static int s1d13524_init_clocks(struct s1d135xx *p)
 		return -1;
 
 	s1d135xx_write_reg(p, S1D13524_REG_POWER_SAVE_MODE, 0x0);
-	s1d135xx_write_reg(p, S1D135XX_REG_I2C_CLOCK, S1D13524_I2C_CLOCK_DIV);
+	if (!p->i2c_clock_div)
+		p->i2c_clock_div = S1D13524_I2C_CLOCK_DIV;
+
+	s1d135xx_write_reg(p, S1D135XX_REG_I2C_CLOCK, p->i2c_clock_div);
 
 	return s1d135xx_wait_idle(p);
 }
@@ -78,6 +78,9 @@
 #define S1D13541_PROM_ERASE_ALL_OP_STOP (1 << 10)
 #define S1D13541_PROM_ERASE_ALL_MODE_STOP       (1 << 11)
 
+/* Maximum time to wait for a PROM status change */
+#define S1D13541_PROM_TIMEOUT_US                500000UL
+
 enum s1d13541_reg {
 	S1D13541_REG_CLOCK_CONFIG          = 0x0010,
 	S1D13541_REG_PROT_KEY_1            = 0x042C,
@@ -128,14 +131,29 @@ static const struct pl_wfid s1d13541_wf_table_new[] = {
 
 #endif
 
+/* Raw interrupt status bits of the events, see enum s1d135xx_event */
+static const uint16_t s1d13541_int_bits[S1D135XX_N_EVENTS] = {
+	S1D13541_INT_RAW_WF_UPDATE,
+	S1D13541_INT_RAW_OUT_OF_RANGE,
+};
+
 /* -- private functions -- */
 
 static int s1d13541_init_clocks(struct s1d135xx *p);
+static void s1d13541_handle_event(struct s1d135xx *p,
+				  enum s1d135xx_event event, void *data);
 static void update_temp(struct s1d135xx *p, uint16_t reg);
 static int update_temp_manual(struct s1d135xx *p, int manual_temp);
 static int update_temp_auto(struct s1d135xx *p, uint16_t temp_reg);
 static int wait_for_ack (struct s1d135xx *p, uint16_t status, uint16_t mask);
 
+static struct s1d135xx_handler s1d13541_handler = {
+	NULL,
+	((1 << S1D135XX_EVENT_WF_UPDATE) | (1 << S1D135XX_EVENT_TEMP_RANGE)),
+	s1d13541_handle_event,
+	NULL,
+};
+
 /* -- pl_epdc interface -- */
 
 static int s1d13541_load_wflib(struct pl_epdc *epdc)
@@ -211,6 +229,8 @@ static int s1d13541_update_temp(struct pl_epdc *epdc)
 
 		if (s1d13541_load_wflib(epdc))
 			return -1;
+
+		p->flags.needs_update = 0;
 	}
 
 	return 0;
@@ -241,6 +261,23 @@ static int s1d13541_load_image(struct pl_epdc *epdc, const char *path,
 				   left, top);
 }
 
+static int s1d13541_load_image_begin(struct pl_epdc *epdc,
+				     const struct pl_area *area)
+{
+	struct s1d135xx *p = epdc->data;
+
+	return s1d135xx_load_image_begin(p, S1D13541_LD_IMG_8BPP, area);
+}
+
+static int s1d13541_load_image_file(struct pl_epdc *epdc, struct pnm_file *img,
+				    struct pl_area *area, int left, int top)
+{
+	struct s1d135xx *p = epdc->data;
+
+	return s1d135xx_load_image_file(p, img, S1D13541_LD_IMG_8BPP, 8, area,
+					left, top);
+}
+
 
 /* -- initialisation -- */
 
@@ -301,6 +338,8 @@ int epson_epdc_init_s1d13541(struct pl_epdc *epdc)
 	epdc->fill = s1d13541_fill;
 	epdc->pattern_check = s1d13541_pattern_check;
 	epdc->load_image = s1d13541_load_image;
+	epdc->load_image_file = s1d13541_load_image_file;
+	epdc->load_image_begin = s1d13541_load_image_begin;
 	if(global_config.waveform_version == 0){
 		epdc->wf_table = s1d13541_wf_table_old;
 	}else{
@@ -310,7 +349,13 @@ int epson_epdc_init_s1d13541(struct pl_epdc *epdc)
 	epdc->xres = s1d135xx_read_reg(p, S1D13541_REG_LINE_DATA_LENGTH);
 	epdc->yres = s1d135xx_read_reg(p, S1D13541_REG_FRAME_DATA_LENGTH);
 
-	return epdc->set_temp_mode(epdc, PL_EPDC_TEMP_INTERNAL);
+	if (epdc->set_temp_mode(epdc, PL_EPDC_TEMP_INTERNAL))
+		return -1;
+
+	s1d135xx_events_init(p, s1d13541_int_bits);
+	s1d135xx_add_handler(p, &s1d13541_handler);
+
+	return 0;
 }
 
 /* ----------------------------------------------------------------------------
@@ -319,22 +364,38 @@ int epson_epdc_init_s1d13541(struct pl_epdc *epdc)
 
 static int s1d13541_init_clocks(struct s1d135xx *p)
 {
-	s1d135xx_write_reg(p, S1D135XX_REG_I2C_CLOCK, S1D13541_I2C_CLOCK_DIV);
+	if (!p->i2c_clock_div)
+		p->i2c_clock_div = S1D13541_I2C_CLOCK_DIV;
+
+	s1d135xx_write_reg(p, S1D135XX_REG_I2C_CLOCK, p->i2c_clock_div);
 	s1d135xx_write_reg(p, S1D13541_REG_CLOCK_CONFIG,
 			   S1D13541_INTERNAL_CLOCK_ENABLE);
 
 	return s1d135xx_wait_idle(p);
 }
 
+static void s1d13541_handle_event(struct s1d135xx *p,
+				  enum s1d135xx_event event, void *data)
+{
+	switch (event) {
+	case S1D135XX_EVENT_WF_UPDATE:
+		/* cleared once the waveform has been reloaded */
+		p->flags.needs_update = 1;
+		break;
+	case S1D135XX_EVENT_TEMP_RANGE:
+		LOG("Temperature out of range");
+		break;
+	default:
+		break;
+	}
+}
+
 static void update_temp(struct s1d135xx *p, uint16_t reg)
 {
 	uint16_t regval;
 
-	regval = s1d135xx_read_reg(p, S1D135XX_REG_INT_RAW_STAT);
-	p->flags.needs_update = (regval & S1D13541_INT_RAW_WF_UPDATE) ? 1 : 0;
-	s1d135xx_write_reg(p, S1D135XX_REG_INT_RAW_STAT,
-			   (S1D13541_INT_RAW_WF_UPDATE |
-			    S1D13541_INT_RAW_OUT_OF_RANGE));
+	/* the temperature judge may have raised WF_UPDATE */
+	s1d135xx_poll_events(p);
 	regval = s1d135xx_read_reg(p, reg) & S1D135XX_TEMP_MASK;
 
 #if VERBOSE_TEMPERATURE
@@ -472,12 +533,10 @@ int s1d13541_extract_prom_blob(uint8_t *data)
 
 static int wait_for_ack (struct s1d135xx *p, uint16_t status, uint16_t mask)
 {
-       unsigned long timeout = 50000;
-       uint16_t v;
-       while ((v = s1d135xx_read_reg(p, S1D13541_PROM_STATUS) & mask) != status){
-              --timeout;
-              v=v;
-              if (timeout == 0){
+       const uint32_t start = pl_time_now_us();
+
+       while ((s1d135xx_read_reg(p, S1D13541_PROM_STATUS) & mask) != status){
+              if (pl_time_since(start) >= S1D13541_PROM_TIMEOUT_US){
                      LOG("PROM acknowledge timeout");
                      return -1;
               }
@@ -41,6 +41,7 @@
 #include "utils.h"
 
 #include <app/parser.h>
+#include "trace.h"
 
 /* Set to 1 to enable verbose update and EPD power on/off log messages */
 #define VERBOSE 0
@@ -56,6 +57,10 @@
 #define S1D135XX_PWR_CTRL_BUSY          0x0080
 #define S1D135XX_PWR_CTRL_CHECK_ON      0x2200
 
+/* Maximum time to wait for HRDY, long enough for a whole waveform at low
+ * temperature as this is also used to wait for the end of an update */
+#define S1D135XX_IDLE_TIMEOUT_US        5000000UL
+
 enum s1d135xx_cmd {
 	S1D135XX_CMD_INIT_SET         	 = 0x00, /* to load init code */
 	S1D135XX_CMD_RUN              	 = 0x02,
@@ -82,13 +87,17 @@ enum s1d135xx_cmd {
 };
 
 static int get_hrdy(struct s1d135xx *p);
+static void dispatch_event(struct s1d135xx *p, enum s1d135xx_event event);
 static int do_fill(struct s1d135xx *p, const struct pl_area *area,
 		   unsigned bpp, uint8_t g);
 static int wflib_wr(void *ctx, const uint8_t *data, size_t n);
 static int transfer_file(struct s1d135xx *p, FIL *file);
-static int transfer_file_scrambled(struct s1d135xx *p, FIL *file, int xres);
-static int transfer_image(struct s1d135xx *p, FIL *f, const struct pl_area *area, int left,
+static int transfer_file_scrambled(struct s1d135xx *p, struct pnm_file *img, int xres);
+static int transfer_image(struct s1d135xx *p, struct pnm_file *img, const struct pl_area *area, int left,
 			  int top, int width, int xres, uint16_t scramble, uint16_t source_offset);
+static int transfer_stream(struct s1d135xx *p, struct pnm_file *img, int top,
+			   int width, uint32_t size);
+static void swap_data(uint16_t *data, size_t n);
 static void transfer_data(struct s1d135xx *p, const uint8_t *data, size_t n);
 static void send_cmd_area(struct s1d135xx *p, uint16_t cmd, uint16_t mode,
 			  const struct pl_area *area);
@@ -183,7 +192,7 @@ int s1d135xx_load_init_code(struct s1d135xx *p)
 	send_cmd(p, S1D135XX_CMD_INIT_STBY);
 	send_param(p, 0x0500);
 	set_cs(p, 1);
-	mdelay(100);
+	msleep(100);
 
 	if (s1d135xx_wait_idle(p))
 		return -1;
@@ -203,10 +212,13 @@ int s1d135xx_load_wflib(struct s1d135xx *p, struct pl_wflib *wflib,
 {
 	uint16_t params[4];
 	uint32_t size2 = wflib->size / 2;
+	int stat;
 
 	if (s1d135xx_wait_idle(p))
 		return -1;
 
+	trace_begin(TRACE_LOAD_WFLIB, wflib->size >> 10);
+
 	params[0] = addr & 0xFFFF;
 	params[1] = (addr >> 16) & 0xFFFF;
 	params[2] = size2 & 0xFFFF;
@@ -216,14 +228,19 @@ int s1d135xx_load_wflib(struct s1d135xx *p, struct pl_wflib *wflib,
 	send_params(p, params, ARRAY_SIZE(params));
 	set_cs(p, 1);
 
-	if (wflib->xfer(wflib, wflib_wr, p))
-		return -1;
-	if (s1d135xx_wait_idle(p))
-		return -1;
+	stat = wflib->xfer(wflib, wflib_wr, p);
 
-	send_cmd_cs(p, S1D135XX_CMD_BST_END_SDR);
+	if (!stat)
+		stat = s1d135xx_wait_idle(p);
 
-	return s1d135xx_wait_idle(p);
+	if (!stat) {
+		send_cmd_cs(p, S1D135XX_CMD_BST_END_SDR);
+		stat = s1d135xx_wait_idle(p);
+	}
+
+	trace_end(TRACE_LOAD_WFLIB, wflib->size >> 10);
+
+	return stat ? -1 : 0;
 }
 
 int s1d135xx_init_gate_drv(struct s1d135xx *p)
@@ -315,16 +332,27 @@ int s1d135xx_load_image(struct s1d135xx *p, const char *path, uint16_t mode,
 			unsigned bpp, struct pl_area *area, int left,
 			int top)
 {
-	struct pnm_header hdr;
-	FIL img_file;
+	struct pnm_file img;
 	int stat;
 
-	if (f_open(&img_file, path, FA_READ) != FR_OK)
+	if (pnm_open(&img, path, NULL, 0))
 		return -1;
 
-	if (pnm_read_header(&img_file, &hdr))
-		return -1;
+	stat = s1d135xx_load_image_file(p, &img, mode, bpp, area, left, top);
+	pnm_close(&img);
+
+	return stat;
+}
 
+int s1d135xx_load_image_file(struct s1d135xx *p, struct pnm_file *img,
+			     uint16_t mode, unsigned bpp,
+			     struct pl_area *area, int left, int top)
+{
+	const struct pnm_header *hdr = &img->hdr;
+	struct pl_area full_area;
+	int stat;
+
+	trace_begin(TRACE_LOAD_IMAGE, hdr->width);
 	set_cs(p, 0);
 
 #if 0 // Area display bug at 4.7" display
@@ -335,16 +363,20 @@ int s1d135xx_load_image(struct s1d135xx *p, const char *path, uint16_t mode,
 		send_param(p, mode);
 	}
 #else
-	if(area == NULL){
+	if (img->flags & PNM_FLAG_SCRAMBLED) {
+		/* already in the controller memory layout: full frame only */
+		send_cmd(p, S1D135XX_CMD_LD_IMG);
+		send_param(p, mode);
+	}else if(area == NULL){
 		if(p->scrambling){
 			send_cmd(p, S1D135XX_CMD_LD_IMG);
 			send_param(p, mode);
 		}else{
-			area = (struct pl_area*) malloc(sizeof(struct pl_area));
-			area->top = 0;
-			area->left = 0;
-			area->width = p->xres;
-			area->height = p->yres;
+			full_area.top = 0;
+			full_area.left = 0;
+			full_area.width = p->xres;
+			full_area.height = p->yres;
+			area = &full_area;
 			send_cmd_area(p, S1D135XX_CMD_LD_IMG_AREA, mode, area /* area_scrambled */);
 		}
 	}else{
@@ -354,28 +386,80 @@ int s1d135xx_load_image(struct s1d135xx *p, const char *path, uint16_t mode,
 #endif
 	set_cs(p, 1);
 
-	if (s1d135xx_wait_idle(p))
-		return -1;
+	stat = s1d135xx_wait_idle(p);
+
+	if (stat)
+		goto exit_trace;
 
 	set_cs(p, 0);
 	send_cmd(p, S1D135XX_CMD_WRITE_REG);
 	send_param(p, S1D135XX_REG_HOST_MEM_PORT);
 
-	if (area == NULL || p->source_offset){
-		stat = transfer_file_scrambled(p, &img_file, hdr.width);
+	if (img->flags & PNM_FLAG_SCRAMBLED){
+		stat = transfer_stream(p, img, 0, 0,
+				       (uint32_t)hdr->width * hdr->height);
+	}else if (area == NULL || p->source_offset){
+		stat = transfer_file_scrambled(p, img, hdr->width);
+	}else if (!left && area->width == hdr->width && area->width <= p->xres){
+		/* whole lines: the pixel data is contiguous in the file */
+		stat = transfer_stream(p, img, top, hdr->width,
+				       (uint32_t)area->width * area->height);
 	}else{
-		stat = transfer_image(p, &img_file, area, left, top, hdr.width, p->xres, p->scrambling, p->source_offset);
-	}
-	if(area){
-		free(area);
+		stat = transfer_image(p, img, area, left, top, hdr->width, p->xres, p->scrambling, p->source_offset);
 	}
 
 	set_cs(p, 1);
-	f_close(&img_file);
 
-	if (stat)
+	if (!stat)
+		stat = s1d135xx_wait_idle(p);
+
+	if (!stat) {
+		send_cmd_cs(p, S1D135XX_CMD_LD_IMG_END);
+		stat = s1d135xx_wait_idle(p);
+	}
+
+exit_trace:
+	trace_end(TRACE_LOAD_IMAGE, hdr->width);
+
+	return stat ? -1 : 0;
+}
+
+int s1d135xx_load_image_begin(struct s1d135xx *p, uint16_t mode,
+			      const struct pl_area *area)
+{
+	assert(area != NULL);
+
+	if (p->scrambling || p->source_offset) {
+		LOG("Image streaming not supported with scrambling");
+		return -1;
+	}
+
+	if (s1d135xx_wait_idle(p))
 		return -1;
 
+	set_cs(p, 0);
+	send_cmd_area(p, S1D135XX_CMD_LD_IMG_AREA, mode, area);
+	set_cs(p, 1);
+
+	return s1d135xx_wait_idle(p);
+}
+
+int s1d135xx_load_image_data(struct s1d135xx *p, const uint8_t *data,
+			     size_t n)
+{
+	assert(!(n & 1));
+
+	set_cs(p, 0);
+	send_cmd(p, S1D135XX_CMD_WRITE_REG);
+	send_param(p, S1D135XX_REG_HOST_MEM_PORT);
+	transfer_data(p, data, n);
+	set_cs(p, 1);
+
+	return 0;
+}
+
+int s1d135xx_load_image_end(struct s1d135xx *p)
+{
 	if (s1d135xx_wait_idle(p))
 		return -1;
 
@@ -395,6 +479,9 @@ int s1d135xx_update(struct s1d135xx *p, int wfid, enum pl_update_mode mode,  con
 		LOG("update %d", wfid);
 #endif
 	uint8_t command = S1D135XX_CMD_UPDATE_FULL + mode;
+	int stat;
+
+	trace_begin(TRACE_UPDATE, wfid);
 	set_cs(p, 0);
 
 	/* wfid = S1D135XX_WF_MODE(wfid); */
@@ -435,31 +522,73 @@ int s1d135xx_update(struct s1d135xx *p, int wfid, enum pl_update_mode mode,  con
 
 	set_cs(p, 1);
 
-	if (s1d135xx_wait_idle(p))
-		return -1;
+	stat = s1d135xx_wait_idle(p);
 
-	return s1d135xx_wait_dspe_trig(p);
+	if (!stat)
+		stat = s1d135xx_wait_dspe_trig(p);
+
+	trace_end(TRACE_UPDATE, wfid);
+
+	return stat;
 }
 
 int s1d135xx_wait_update_end(struct s1d135xx *p)
 {
-	send_cmd_cs(p, S1D135XX_CMD_WAIT_DSPE_FREND);
+	int stat;
 
-	return s1d135xx_wait_idle(p);
+	trace_begin(TRACE_WAIT_UPDATE_END, 0);
+
+	if (p->flags.frend_sent)
+		p->flags.frend_sent = 0;
+	else
+		send_cmd_cs(p, S1D135XX_CMD_WAIT_DSPE_FREND);
+
+	/* nothing else to do until the waveform has completed */
+	cpu_idle_begin();
+	stat = s1d135xx_wait_idle(p);
+	cpu_idle_end();
+	trace_end(TRACE_WAIT_UPDATE_END, 0);
+
+	return stat;
+}
+
+int s1d135xx_update_done(struct s1d135xx *p)
+{
+	/* the controller stays busy until the end of the update, so it can't
+	 * be used for anything else until s1d135xx_wait_update_end() */
+	if (!p->flags.frend_sent) {
+		send_cmd_cs(p, S1D135XX_CMD_WAIT_DSPE_FREND);
+		p->flags.frend_sent = 1;
+	}
+
+	return get_hrdy(p);
 }
 
 int s1d135xx_wait_idle(struct s1d135xx *p)
 {
-	unsigned long timeout = 100000;
+	uint32_t start;
+	int stat = 0;
 
-	while (!get_hrdy(p) && --timeout);
+	/* only trace the calls which actually have to wait */
+	if (get_hrdy(p))
+		return 0;
 
-	if (!timeout) {
-		LOG("HRDY timeout");
-		return -1;
+	trace_begin(TRACE_WAIT_IDLE, 0);
+	start = pl_time_now_us();
+
+	while (!get_hrdy(p)) {
+		if (pl_time_since(start) >= S1D135XX_IDLE_TIMEOUT_US) {
+			stat = -1;
+			break;
+		}
 	}
 
-	return 0;
+	trace_end(TRACE_WAIT_IDLE, 0);
+
+	if (stat)
+		LOG("HRDY timeout");
+
+	return stat;
 }
 
 int s1d135xx_set_power_state(struct s1d135xx *p,
@@ -587,11 +716,36 @@ void s1d135xx_write_reg(struct s1d135xx *p, uint16_t reg, uint16_t val)
 	set_cs(p, 1);
 }
 
+void s1d135xx_write_regs(struct s1d135xx *p, const uint16_t *regs, size_t n)
+{
+	/* with HDC, commands can follow each other with CS kept low */
+	const int batch = (p->data->hdc != PL_GPIO_NONE);
+
+	if (batch)
+		set_cs(p, 0);
+
+	while (n--) {
+		if (!batch)
+			set_cs(p, 0);
+
+		send_cmd(p, S1D135XX_CMD_WRITE_REG);
+		send_params(p, regs, 2);
+		regs += 2;
+
+		if (!batch)
+			set_cs(p, 1);
+	}
+
+	if (batch)
+		set_cs(p, 1);
+}
+
 int s1d135xx_load_register_overrides(struct s1d135xx *p)
 {
 	static const char override_path[] = "bin/override.txt";
 	static const char sep[] = ", ";
 	FIL file;
+	struct parser_file reader;
 	FRESULT res;
 	int stat;
 	uint16_t reg, val;
@@ -607,11 +761,12 @@ int s1d135xx_load_register_overrides(struct s1d135xx *p)
 		}
 	}
 
+	parser_file_init(&reader, &file);
 	stat = 0;
 	while (!stat) {
 		char line[81];
 		int len;
-		stat = parser_read_file_line(&file, line, sizeof(line));
+		stat = parser_read_file_line(&reader, line, sizeof(line));
 		if (stat < 0) {
 			LOG("Failed to read line");
 			break;
@@ -648,10 +803,89 @@ int s1d135xx_load_register_overrides(struct s1d135xx *p)
 	return stat;
 }
 
+void s1d135xx_events_init(struct s1d135xx *p, const uint16_t *int_bits)
+{
+	uint16_t mask = 0;
+	int i;
+
+	assert(int_bits != NULL);
+
+	for (i = 0; i < S1D135XX_N_EVENTS; ++i)
+		mask |= int_bits[i];
+
+	p->int_bits = int_bits;
+	s1d135xx_write_reg(p, S1D135XX_REG_INT_RAW_STAT, mask);
+}
+
+void s1d135xx_poll_events(struct s1d135xx *p)
+{
+	uint16_t stat = 0;
+	int i;
+
+	if (p->int_bits == NULL)
+		return;
+
+	/* the controller is waiting for the end of the update and can't be
+	 * accessed, the status is read again next time */
+	if (p->flags.frend_sent)
+		return;
+
+	for (i = 0; i < S1D135XX_N_EVENTS; ++i)
+		stat |= p->int_bits[i];
+
+	stat &= s1d135xx_read_reg(p, S1D135XX_REG_INT_RAW_STAT);
+
+	if (!stat)
+		return;
+
+	s1d135xx_write_reg(p, S1D135XX_REG_INT_RAW_STAT, stat);
+
+	for (i = 0; i < S1D135XX_N_EVENTS; ++i)
+		if (stat & p->int_bits[i])
+			dispatch_event(p, i);
+}
+
+void s1d135xx_add_handler(struct s1d135xx *p, struct s1d135xx_handler *h)
+{
+	struct s1d135xx_handler *it;
+
+	assert(h != NULL);
+	assert(h->handle != NULL);
+
+	for (it = p->handlers; it != NULL; it = it->next)
+		if (it == h)
+			return;
+
+	h->next = p->handlers;
+	p->handlers = h;
+}
+
+void s1d135xx_remove_handler(struct s1d135xx *p, struct s1d135xx_handler *h)
+{
+	struct s1d135xx_handler **it;
+
+	for (it = &p->handlers; *it != NULL; it = &(*it)->next) {
+		if (*it == h) {
+			*it = h->next;
+			h->next = NULL;
+			break;
+		}
+	}
+}
+
 /* ----------------------------------------------------------------------------
  * private functions
  */
 
+static void dispatch_event(struct s1d135xx *p, enum s1d135xx_event event)
+{
+	struct s1d135xx_handler *h;
+
+	for (h = p->handlers; h != NULL; h = h->next)
+		if (h->events & (1 << event))
+			h->handle(p, event, h->data);
+}
+
 static int get_hrdy(struct s1d135xx *p)
 {
 	uint16_t status;
@@ -781,7 +1015,7 @@ static void memory_padding(uint8_t *source, uint8_t *target,  int s_gl, int s_sl
 		}
 }
 
-static int transfer_file_scrambled(struct s1d135xx *p, FIL *file, int xres)
+static int transfer_file_scrambled(struct s1d135xx *p, struct pnm_file *img, int xres)
 {
 	//LOG("%s", __func__);
 	// we need to scramble the image so we need to read the file line by line
@@ -793,7 +1027,7 @@ static int transfer_file_scrambled(struct s1d135xx *p, FIL *file, int xres)
 		uint16_t gl = 1;
 		uint16_t sl = xres;
 		// read one line of the image
-		if (f_read(file, data, xres, &count) != FR_OK)
+		if (pnm_read(img, data, xres, &count))
 			return -1;
 
 		if (!count)
@@ -811,7 +1045,7 @@ static int transfer_file_scrambled(struct s1d135xx *p, FIL *file, int xres)
 	return 0;
 }
 
-static int transfer_image(struct s1d135xx *p, FIL *f, const struct pl_area *area, int left,
+static int transfer_image(struct s1d135xx *p, struct pnm_file *img, const struct pl_area *area, int left,
 			  int top, int width, int xres, uint16_t scramble, uint16_t source_offset)
 {
 	//LOG("%s", __func__);
@@ -835,7 +1069,7 @@ static int transfer_image(struct s1d135xx *p, FIL *f, const struct pl_area *area
 		return -1;
 	}
 
-	if (f_lseek(f, f->fptr + ((long)top * (unsigned long)width)) != FR_OK)
+	if (pnm_seek(img, pnm_tell(img) + ((long)top * (unsigned long)width)))
 		return -1;
 
 	for (line = area->height; line; --line) {
@@ -843,7 +1077,7 @@ static int transfer_image(struct s1d135xx *p, FIL *f, const struct pl_area *area
 		size_t remaining = area->width;
 
 		/* Find the first relevant pixel (byte) on this line */
-		if (f_lseek(f, f->fptr + (unsigned long)left) != FR_OK)
+		if (pnm_seek(img, pnm_tell(img) + (unsigned long)left))
 			return -1;
 
 		/* Transfer data of interest in chunks */
@@ -851,7 +1085,7 @@ static int transfer_image(struct s1d135xx *p, FIL *f, const struct pl_area *area
 			size_t btr = (remaining <= buffer_length) ?
 					remaining : buffer_length;
 
-			if (f_read(f, data, btr, &count) != FR_OK)
+			if (pnm_read(img, data, btr, &count))
 				return -1;
 
 			if(scramble_array(data, scrambled_data, &gl, &sl ,scramble)){
@@ -863,13 +1097,70 @@ static int transfer_image(struct s1d135xx *p, FIL *f, const struct pl_area *area
 		}
 
 		/* Move file pointer to end of line */
-		if (f_lseek(f, f->fptr + (width - (left + area->width))) != FR_OK)
+		if (pnm_seek(img, pnm_tell(img) + (width - (left + area->width))))
 			return -1;
 	}
 
 	return 0;
 }
 
+/**
+ * Stream pixel data to the EPDC as-is.  When the interface supports DMA, the
+ * data is read from the file into one half of a double buffer while the other
+ * half is being sent to the EPDC, so the CPU only has to swap the bytes and
+ * walk the FAT.
+ */
+static int transfer_stream(struct s1d135xx *p, struct pnm_file *img, int top,
+			   int width, uint32_t size)
+{
+	uint16_t data[2][DATA_BUFFER_LENGTH / 4];
+	unsigned i = 0;
+	int stat = 0;
+
+	if (pnm_seek(img, pnm_tell(img) + ((long)top * (unsigned long)width)))
+		return -1;
+
+	while (size) {
+		size_t btr = (size < sizeof(data[i])) ? size : sizeof(data[i]);
+		size_t count;
+
+		if (pnm_read(img, data[i], btr, &count)) {
+			stat = -1;
+			break;
+		}
+
+		if (!count)
+			break;
+
+		if (p->interface->dma_write == NULL) {
+			transfer_data(p, (const uint8_t *)data[i], count);
+		} else {
+			/* same byte order as transfer_data() */
+			swap_data(data[i], count);
+			p->interface->dma_wait();
+			p->interface->dma_write((const uint8_t *)data[i], count);
+		}
+
+		size -= count;
+		i ^= 1;
+	}
+
+	if (p->interface->dma_wait != NULL)
+		p->interface->dma_wait();
+
+	return stat;
+}
+
+static void swap_data(uint16_t *data, size_t n)
+{
+	n /= 2;
+
+	while (n--) {
+		*data = htobe16(*data);
+		++data;
+	}
+}
+
 static void transfer_data(struct s1d135xx *p, const uint8_t *data, size_t n)
 {
 	const uint16_t *data16 = (const uint16_t *)data;
@@ -949,6 +1240,6 @@ int set_init_rot_mode(struct s1d135xx *p)
 	send_cmd(p, S1D135XX_CMD_INIT_ROT_MODE);
 	send_param(p, 0x0400);
 	set_cs(p, 1);
-	mdelay(100);
+	msleep(100);
 	return s1d135xx_wait_idle(p);
 }
@@ -34,6 +34,7 @@
 
 struct pl_gpio;
 struct pl_wflib;
+struct pnm_file;
 
 /* Set to 1 to enable verbose temperature log messages */
 #define VERBOSE_TEMPERATURE                  0
@@ -54,6 +55,24 @@ enum s1d135xx_reg {
 	S1D135XX_REG_INT_RAW_STAT          = 0x033A,
 };
 
+/** Controller events, from the raw interrupt status */
+enum s1d135xx_event {
+	S1D135XX_EVENT_WF_UPDATE = 0,	/**< waveform needs to be reloaded */
+	S1D135XX_EVENT_TEMP_RANGE,	/**< temperature out of range */
+	S1D135XX_N_EVENTS
+};
+
+struct s1d135xx;
+
+/** Event handler, called from s1d135xx_poll_events() */
+struct s1d135xx_handler {
+	struct s1d135xx_handler *next;
+	uint8_t events;		/* bitmask of (1 << enum s1d135xx_event) */
+	void (*handle)(struct s1d135xx *p, enum s1d135xx_event event,
+		       void *data);
+	void *data;
+};
+
 enum s1d135xx_rot_mode {
 	S1D135XX_ROT_MODE_0   = 0,
 	S1D135XX_ROT_MODE_90  = 1,
@@ -82,8 +101,14 @@ struct s1d135xx {
 	int measured_temp;
 	unsigned xres;
 	unsigned yres;
+	uint16_t i2c_clock_div; /* I2C bridge clock divider, 0 for default */
+	uint16_t i2c_poll_us;   /* delay before checking an I2C bridge byte */
+	uint8_t i2c_poll_hits;  /* consecutive bytes done on the first check */
+	const uint16_t *int_bits; /* raw status bit of each event, or 0 */
+	struct s1d135xx_handler *handlers;
 	struct {
 		uint8_t needs_update:1;
+		uint8_t frend_sent:1;
 	} flags;
 };
 
@@ -104,10 +129,22 @@ extern int s1d135xx_pattern_check(struct s1d135xx *p, uint16_t height,
 extern int s1d135xx_load_image(struct s1d135xx *p, const char *path,
 			       uint16_t mode, unsigned bpp,
 			       struct pl_area *area, int left, int top);
+extern int s1d135xx_load_image_file(struct s1d135xx *p, struct pnm_file *img,
+				    uint16_t mode, unsigned bpp,
+				    struct pl_area *area, int left, int top);
+/* Start loading 16-bit aligned image data in area, sent in any number of
+ * chunks with s1d135xx_load_image_data() then s1d135xx_load_image_end().
+ * Other registers can be accessed in between. */
+extern int s1d135xx_load_image_begin(struct s1d135xx *p, uint16_t mode,
+				     const struct pl_area *area);
+extern int s1d135xx_load_image_data(struct s1d135xx *p, const uint8_t *data,
+				    size_t n);
+extern int s1d135xx_load_image_end(struct s1d135xx *p);
 extern int s1d135xx_update(struct s1d135xx *p, int wfid,
 				enum pl_update_mode mode,
 				const struct pl_area *area);
 extern int s1d135xx_wait_update_end(struct s1d135xx *p);
+extern int s1d135xx_update_done(struct s1d135xx *p);
 extern int s1d135xx_wait_idle(struct s1d135xx *p);
 extern int s1d135xx_set_power_state(struct s1d135xx *p,
 				    enum pl_epdc_power_state state);
@@ -116,8 +153,24 @@ extern void s1d135xx_cmd(struct s1d135xx *p, uint16_t cmd,
 			 const uint16_t *params, size_t n);
 extern uint16_t s1d135xx_read_reg(struct s1d135xx *p, uint16_t reg);
 extern void s1d135xx_write_reg(struct s1d135xx *p, uint16_t reg, uint16_t val);
+/* Write n registers given as { reg, val } pairs in regs, in a single chip
+ * select cycle when the HDC line is available */
+extern void s1d135xx_write_regs(struct s1d135xx *p, const uint16_t *regs,
+				size_t n);
 extern int s1d135xx_load_register_overrides(struct s1d135xx *p);
 
+/* Set the raw interrupt status bit of each enum s1d135xx_event (0 when not
+ * available) and drop the events from before the init */
+extern void s1d135xx_events_init(struct s1d135xx *p, const uint16_t *int_bits);
+/* Read and acknowledge the raw interrupt status once and call the handlers of
+ * the pending events.  Nothing is done while waiting for the end of an update
+ * after s1d135xx_update_done(), the events are then left for the next call. */
+extern void s1d135xx_poll_events(struct s1d135xx *p);
+extern void s1d135xx_add_handler(struct s1d135xx *p,
+				 struct s1d135xx_handler *h);
+extern void s1d135xx_remove_handler(struct s1d135xx *p,
+				    struct s1d135xx_handler *h);
+
 extern int s1d13541_extract_prom_blob(uint8_t *data);
 extern int s1d13541_read_prom(struct s1d135xx *p, uint8_t * blob);
 
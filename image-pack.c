@@ -0,0 +1,200 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * image-pack.c -- Image pack files
+ *
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include "assert.h"
+#include "pnm-utils.h"
+#include "image-pack.h"
+
+#define LOG_TAG "image-pack"
+#include "utils.h"
+
+static int open_pack(FIL *f, const char *path, uint16_t *count);
+static int read_entry(FIL *f, unsigned index, struct image_pack_entry *e);
+
+int image_pack_parse_ref(const char *ref, char *path, size_t n,
+			 unsigned *index)
+{
+	const char *sep = strrchr(ref, ':');
+	const char *it;
+	size_t len;
+	unsigned i;
+
+	if ((sep == NULL) || (sep[1] == '\0'))
+		return 0;
+
+	for (it = &sep[1], i = 0; *it != '\0'; ++it) {
+		if (!isdigit(*it))
+			return 0;
+
+		i = (i * 10) + (*it - '0');
+	}
+
+	/* only accept .pak files so a drive number is not mistaken for an
+	 * image index */
+	len = sep - ref;
+
+	if ((len < 4) || (strncmp(&sep[-4], ".PAK", 4) &&
+			  strncmp(&sep[-4], ".pak", 4)))
+		return 0;
+
+	if (len >= n)
+		return -1;
+
+	memcpy(path, ref, len);
+	path[len] = '\0';
+	*index = i;
+
+	return 1;
+}
+
+int image_pack_open(struct pnm_file *img, const char *path, unsigned index,
+		    uint8_t *buf, UINT buf_size)
+{
+	struct image_pack_entry e;
+	uint16_t count;
+
+	assert(img != NULL);
+	assert(path != NULL);
+
+	if (open_pack(&img->f, path, &count))
+		return -1;
+
+	if (index >= count) {
+		LOG("Invalid image index: %u, count=%u", index, count);
+		goto error_close;
+	}
+
+	if (read_entry(&img->f, index, &e))
+		goto error_close;
+
+	if (f_lseek(&img->f, e.data_offset) != FR_OK)
+		goto error_close;
+
+	img->hdr.type = PNM_GREYSCALE;
+	img->hdr.width = e.width;
+	img->hdr.height = e.height;
+	img->hdr.max_gray = 255;
+
+	if (pnm_prefetch(img, buf, buf_size))
+		goto error_close;
+
+	img->flags = e.flags;
+
+	return 0;
+
+error_close:
+	f_close(&img->f);
+
+	return -1;
+}
+
+int image_pack_index(const char *path, struct pnm_ref *refs, unsigned max,
+		     unsigned *count)
+{
+	struct image_pack_entry e;
+	uint16_t n;
+	unsigned i;
+	FIL f;
+	int stat = 0;
+
+	assert(path != NULL);
+	assert(count != NULL);
+
+	if (open_pack(&f, path, &n))
+		return -1;
+
+	for (i = 0; (i < n) && (i < max); ++i) {
+		if (read_entry(&f, i, &e)) {
+			stat = -1;
+			break;
+		}
+
+		refs[i].sclust = f.org_clust;
+		refs[i].fsize = f.fsize;
+		refs[i].data_offset = e.data_offset;
+		refs[i].width = e.width;
+		refs[i].height = e.height;
+		refs[i].flags = e.flags;
+	}
+
+	f_close(&f);
+	*count = n;
+
+	return stat;
+}
+
+/* ----------------------------------------------------------------------------
+ * static functions
+ */
+
+static int open_pack(FIL *f, const char *path, uint16_t *count)
+{
+	struct image_pack_header hdr;
+	UINT n;
+
+	if (f_open(f, path, FA_READ) != FR_OK) {
+		LOG("Failed to open %s", path);
+		return -1;
+	}
+
+	if ((f_read(f, &hdr, sizeof(hdr), &n) != FR_OK) ||
+	    (n != sizeof(hdr)))
+		goto error_close;
+
+	if (memcmp(hdr.magic, IMAGE_PACK_MAGIC, sizeof(hdr.magic)) ||
+	    (hdr.version != IMAGE_PACK_VERSION)) {
+		LOG("Invalid image pack header");
+		goto error_close;
+	}
+
+	*count = hdr.count;
+
+	return 0;
+
+error_close:
+	f_close(f);
+
+	return -1;
+}
+
+static int read_entry(FIL *f, unsigned index, struct image_pack_entry *e)
+{
+	const DWORD offset = sizeof(struct image_pack_header) +
+		((DWORD)index * sizeof(struct image_pack_entry));
+	UINT n;
+
+	if (f_lseek(f, offset) != FR_OK)
+		return -1;
+
+	if ((f_read(f, e, sizeof(*e), &n) != FR_OK) || (n != sizeof(*e)))
+		return -1;
+
+	if (e->bpp != 8) {
+		LOG("Unsupported bpp: %u", e->bpp);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * image-pack.h -- Image pack files
+ *
+ * An image pack holds several images in a single file with a binary index,
+ * so an image can be opened with one seek and no text parsing.  Packs are
+ * created with tools/make_pack.py.  All values are little-endian:
+ *
+ *   struct image_pack_header
+ *   struct image_pack_entry  x count
+ *   pixel data, each image starting on a 512-byte boundary
+ *
+ * Images in a pack are referred to as "path:index", for example
+ * "img/slides.pak:3", anywhere a PNM file path is accepted.
+ */
+
+#ifndef INCLUDE_IMAGE_PACK_H
+#define INCLUDE_IMAGE_PACK_H 1
+
+#include <FatFs/ff.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IMAGE_PACK_MAGIC "PLPK"
+#define IMAGE_PACK_VERSION 1
+
+/* Image entry flags */
+#define IMAGE_PACK_SCRAMBLED (1 << 0) /* already in the EPDC memory layout */
+
+struct pnm_file;
+struct pnm_ref;
+
+struct image_pack_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t count;
+};
+
+struct image_pack_entry {
+	uint16_t width;
+	uint16_t height;
+	uint8_t bpp;
+	uint8_t flags;
+	uint16_t reserved;
+	uint32_t data_offset;
+	uint32_t data_size;
+};
+
+/** Check whether path is a pack reference, and if so split it into the
+ * pack file path and the image index.  Returns 1 if it is a reference, 0 if
+ * not and -1 if the pack path is too long.  */
+extern int image_pack_parse_ref(const char *ref, char *path, size_t n,
+				unsigned *index);
+
+/** Open an image from a pack, see pnm_open() */
+extern int image_pack_open(struct pnm_file *img, const char *path,
+			   unsigned index, uint8_t *buf, UINT buf_size);
+
+/** Get references to the images in a pack, up to max of them.  The number
+ * of images in the pack is returned in count, which may be more than max. */
+extern int image_pack_index(const char *path, struct pnm_ref *refs,
+			    unsigned max, unsigned *count);
+
+#endif /* INCLUDE_IMAGE_PACK_H */
@@ -30,6 +30,7 @@
 #include <pl/gpio.h>
 #include <pl/interface.h>
 #include <pl/hwinfo.h>
+#include <pl/energy.h>
 #include <pl/wflib.h>
 #include <app/app.h>
 #include <FatFs/ff.h>
@@ -40,6 +41,7 @@
 #include "assert.h"
 #include "config.h"
 #include "probe.h"
+#include "trace.h"
 #include "msp430-i2c.h"
 #include "msp430-gpio.h"
 #include "msp430-sdcard.h"
@@ -127,7 +129,7 @@ static struct pl_epdpsu_gpio g_epdpsu_gpio = {
 };
 
 static struct pl_epdpsu_i2c g_epdpsu_i2c = {
-	&g_plat.gpio, NULL, LED4,  30, 10, 100
+	&g_plat.gpio, NULL, LED4, PMIC_POK, 30, 10, 100
 };
 
 
@@ -368,6 +370,11 @@ int main_init(void)
 	s1d135xx.scrambling = global_config.scrambling;
 	s1d135xx.source_offset = global_config.source_offset;
 
+	/* start recording timing events if a trace file is present */
+	if (trace_init("trace.bin"))
+		LOG("Tracing disabled");
+	pl_energy_reset();
+
 	struct pl_hwinfo g_hwinfo_default = init_hw_info_default();
 
 	/* load hardware information */
@@ -400,11 +407,21 @@ int main_init(void)
 	g_epdpsu_i2c.i2c = g_plat.i2c;
 	if (probe_hvpmic(&g_plat, &vcom_cal, &g_epdpsu_gpio, &g_epdpsu_i2c, &pmic_info))
 		abort_msg("HV-PMIC and EPD PSU init failed", ABORT_HVPSU_INIT);
+	if (global_config.psu_keep_alive_ms > 0)
+		g_plat.psu.keep_alive_ms = global_config.psu_keep_alive_ms;
 
 	/* initialise EPDC */
 	if (probe_epdc(&g_plat, &s1d135xx))
 		abort_msg("EPDC init failed", ABORT_EPDC_INIT);
 
+	/* use calibrated EPD PSU delays if available */
+	probe_psu_delays(&g_plat, &g_epdpsu_gpio, &g_epdpsu_i2c,
+			 &global_config);
+
+	/* use the HV-PMIC temperature sensor if enabled */
+	if (global_config.pmic_temp && probe_temp_sensor(&g_plat, &pmic_info))
+		LOG("Failed to use the HV-PMIC temperature sensor");
+
 	// debug -> read and print PROM content (MaterialID, WF-ID, VCOM)
 	uint8_t blob[16];
 	s1d13541_read_prom(&s1d135xx, blob);
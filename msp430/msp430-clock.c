@@ -0,0 +1,158 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * msp430-clock.c -- MSP430 clock governor
+ *
+ */
+
+#include <msp430.h>
+#include <stdint.h>
+#include "assert.h"
+#include "hal_pmm.h"
+#include "msp430-clock.h"
+#include "trace.h"
+#include "utils.h"
+
+/* VCore level used when idle, enough for MCLK up to 12MHz */
+#define IDLE_VCORE PMMCOREV_1
+#define FULL_VCORE PMMCOREV_3
+
+#if MSP430_CLOCK_IDLE_SHIFT != 3
+#error IDLE_DIV needs to be updated
+#endif
+#define IDLE_DIV (DIVM_3 | DIVS_3)
+#define DIV_MASK (DIVM_7 | DIVS_7)
+
+static struct msp430_clock_notifier *clock_notifiers;
+static enum msp430_clock_speed clock_speed = MSP430_CLOCK_FULL;
+static uint8_t clock_idle_depth;
+static uint8_t clock_busy_depth;
+
+void msp430_clock_register(struct msp430_clock_notifier *n)
+{
+	struct msp430_clock_notifier *it;
+
+	assert(n != NULL);
+	assert(clock_speed == MSP430_CLOCK_FULL);
+
+	/* drivers may be initialised several times */
+	for (it = clock_notifiers; it != NULL; it = it->next)
+		if (it == n)
+			return;
+
+	n->next = clock_notifiers;
+	clock_notifiers = n;
+}
+
+enum msp430_clock_speed msp430_clock_get_speed(void)
+{
+	return clock_speed;
+}
+
+uint16_t msp430_clock_div(uint16_t div)
+{
+	if (clock_speed == MSP430_CLOCK_FULL)
+		return div;
+
+	/* round up so the bit rate never goes above the full speed one */
+	div += (1 << MSP430_CLOCK_IDLE_SHIFT) - 1;
+
+	return div >> MSP430_CLOCK_IDLE_SHIFT;
+}
+
+static void clock_quiesce(void)
+{
+	struct msp430_clock_notifier *n;
+
+	for (n = clock_notifiers; n != NULL; n = n->next)
+		if (n->quiesce != NULL)
+			n->quiesce();
+}
+
+static void clock_notify(enum msp430_clock_speed speed)
+{
+	struct msp430_clock_notifier *n;
+
+	for (n = clock_notifiers; n != NULL; n = n->next)
+		n->notify(speed);
+}
+
+/* The notifiers wait for any on-going USCI transfer to complete before
+ * changing the dividers, so this must not be called from an interrupt
+ * handler or with interrupts disabled.  The voltage is raised before the
+ * frequency and lowered after. */
+static void clock_set_speed(enum msp430_clock_speed speed)
+{
+	unsigned int gie = __get_SR_register() & GIE;
+
+	clock_quiesce();
+
+	if (speed == MSP430_CLOCK_FULL)
+		SetVCore(FULL_VCORE);
+
+	__disable_interrupt();
+	UCSCTL5 = (UCSCTL5 & ~DIV_MASK) |
+		((speed == MSP430_CLOCK_IDLE) ? IDLE_DIV : 0);
+	clock_speed = speed;
+	clock_notify(speed);
+	__bis_SR_register(gie);
+
+	if (speed == MSP430_CLOCK_IDLE)
+		SetVCore(IDLE_VCORE);
+}
+
+static void clock_idle(void)
+{
+	trace_begin(TRACE_CPU_IDLE, 0);
+	clock_set_speed(MSP430_CLOCK_IDLE);
+}
+
+static void clock_full(void)
+{
+	clock_set_speed(MSP430_CLOCK_FULL);
+	trace_end(TRACE_CPU_IDLE, 0);
+}
+
+void cpu_idle_begin(void)
+{
+	if (!clock_idle_depth++ && !clock_busy_depth)
+		clock_idle();
+}
+
+void cpu_idle_end(void)
+{
+	assert(clock_idle_depth);
+
+	if (!--clock_idle_depth && !clock_busy_depth)
+		clock_full();
+}
+
+void cpu_busy_begin(void)
+{
+	if (!clock_busy_depth++ && clock_idle_depth)
+		clock_full();
+}
+
+void cpu_busy_end(void)
+{
+	assert(clock_busy_depth);
+
+	if (!--clock_busy_depth && clock_idle_depth)
+		clock_idle();
+}
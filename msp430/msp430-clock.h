@@ -0,0 +1,61 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * msp430-clock.h -- MSP430 clock governor
+ *
+ */
+
+#ifndef MSP430_CLOCK_H
+#define MSP430_CLOCK_H 1
+
+#include <stdint.h>
+
+/* While idle, MCLK and SMCLK are divided by 1 << MSP430_CLOCK_IDLE_SHIFT.
+ * The DCO and its FLL keep running so going back to full speed is
+ * immediate. */
+#define MSP430_CLOCK_IDLE_SHIFT 3
+
+enum msp430_clock_speed {
+	MSP430_CLOCK_FULL = 0,		/* 20MHz, VCore level 3 */
+	MSP430_CLOCK_IDLE,		/* 2.5MHz, lower VCore level */
+};
+
+/** Called after SMCLK has changed, to reprogram a USCI bit rate divider.
+ * The optional quiesce function is called with interrupts enabled before the
+ * change, to let interrupt-driven transfers complete and hold new ones until
+ * notify has been called. */
+struct msp430_clock_notifier {
+	struct msp430_clock_notifier *next;
+	void (*notify)(enum msp430_clock_speed speed);
+	void (*quiesce)(void);
+};
+
+/** Register a notifier, to be called with the current clock speed at
+ * full speed, typically during initialisation */
+extern void msp430_clock_register(struct msp430_clock_notifier *n);
+
+/** Get the current clock speed */
+extern enum msp430_clock_speed msp430_clock_get_speed(void);
+
+/** Scale a USCI bit rate divider, given for the full SMCLK speed, to the
+ * current clock speed.  The resulting bit rate may be slightly lower when
+ * the divider is not a multiple of the idle clock ratio. */
+extern uint16_t msp430_clock_div(uint16_t div);
+
+#endif /* MSP430_CLOCK_H */
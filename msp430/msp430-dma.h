@@ -0,0 +1,46 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * msp430-dma.h -- MSP430 DMA channel allocation and trigger sources
+ *
+ */
+
+#ifndef MSP430_DMA_H
+#define MSP430_DMA_H 1
+
+/* DMA trigger sources, see the MSP430F543xA data sheet */
+#define MSP430_DMA_TRIG_UCA0RXIFG	16
+#define MSP430_DMA_TRIG_UCA0TXIFG	17
+#define MSP430_DMA_TRIG_UCB0RXIFG	18
+#define MSP430_DMA_TRIG_UCB0TXIFG	19
+
+/* Static channel allocation, channel 0 has the highest priority */
+#define MSP430_DMA_CH_SD_RX		0	/* SD card, USCI_B0 RXBUF -> RAM */
+#define MSP430_DMA_CH_SD_TX		1	/* SD card, dummy bytes -> TXBUF */
+#define MSP430_DMA_CH_SPI_TX		2	/* EPDC SPI, RAM -> USCI_A0 TXBUF */
+
+/* Trigger select fields in DMACTL0 (channels 0 and 1) and DMACTL1 (2) */
+#define MSP430_DMA0_TSEL(_t)		((_t) & 0x1F)
+#define MSP430_DMA1_TSEL(_t)		(((_t) & 0x1F) << 8)
+#define MSP430_DMA2_TSEL(_t)		((_t) & 0x1F)
+#define MSP430_DMA0_TSEL_MASK		0x001F
+#define MSP430_DMA1_TSEL_MASK		0x1F00
+#define MSP430_DMA2_TSEL_MASK		0x001F
+
+#endif /* MSP430_DMA_H */
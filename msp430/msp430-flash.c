@@ -0,0 +1,70 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * msp430-flash.c -- MSP430 information memory programming
+ *
+ */
+
+#include <msp430.h>
+#include <stdint.h>
+#include "assert.h"
+#include "msp430-flash.h"
+
+#define LOG_TAG "flash"
+#include "utils.h"
+
+int msp430_flash_write_info(void *segment, const void *data, size_t len)
+{
+	const uint8_t *src = data;
+	uint8_t *dst = segment;
+	unsigned int gie;
+	size_t i;
+
+	assert(segment != NULL);
+	assert(data != NULL);
+
+	if (len > MSP430_FLASH_INFO_SEGMENT_SIZE)
+		return -1;
+
+	gie = __get_SR_register() & GIE;	// Store current GIE state
+	__disable_interrupt();
+
+	FCTL3 = FWKEY;				// Clear LOCK
+	FCTL1 = FWKEY | ERASE;			// Segment erase
+	*dst = 0;				// Dummy write to start erase
+
+	FCTL1 = FWKEY | WRT;			// Byte write
+
+	for (i = 0; i < len; ++i)
+		dst[i] = src[i];
+
+	FCTL1 = FWKEY;
+	FCTL3 = FWKEY | LOCK;			// Set LOCK
+
+	__bis_SR_register(gie);			// Restore original GIE state
+
+	for (i = 0; i < len; ++i) {
+		if (dst[i] != src[i]) {
+			LOG("Verify failed at 0x%04X", (unsigned)&dst[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
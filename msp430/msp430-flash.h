@@ -0,0 +1,40 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * msp430-flash.h -- MSP430 information memory programming
+ *
+ */
+
+#ifndef MSP430_FLASH_H
+#define MSP430_FLASH_H 1
+
+#include <stddef.h>
+
+/* Information memory segments, 128 bytes each.  Segment A holds calibration
+ * data and is locked, the others are free for the application. */
+#define MSP430_FLASH_INFO_SEGMENT_SIZE	128
+#define MSP430_FLASH_INFO_D		((void *)0x1800)
+#define MSP430_FLASH_INFO_C		((void *)0x1880)
+#define MSP430_FLASH_INFO_B		((void *)0x1900)
+
+/** Erase an information memory segment and write len bytes of data to it */
+extern int msp430_flash_write_info(void *segment, const void *data,
+				   size_t len);
+
+#endif /* MSP430_FLASH_H */
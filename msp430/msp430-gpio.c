@@ -40,6 +40,7 @@
 #include "assert.h"
 #include "msp430-gpio.h"
 #include "plat-gpio.h"
+#include "hal_digio.h"
 
 #define LOG_TAG "msp430-gpio"
 #include "utils.h"
@@ -71,6 +72,9 @@ static int msp430_gpio_pin_number(uint16_t pinmask);
 static void msp430_gpio_check_port(uint16_t port);
 static const struct io_config *msp430_gpio_get_port(unsigned gpio);
 
+/* Pins of ports 1 and 2 which have seen an edge in msp430_gpio_wait */
+static volatile uint8_t msp430_gpio_events[2];
+
 /* Could maybe not store offsets if we can compute them?
  * This is a big table but it's in flash. */
 static const struct io_config {
@@ -235,15 +239,103 @@ void msp430_gpio_set(unsigned gpio, int value)
 		*port->out &= ~pinmask;
 }
 
+/* Use the port interrupt to wake up as soon as the pin changes, other ports
+ * are polled every millisecond */
+static int msp430_gpio_wait(unsigned gpio, int value, unsigned timeout_ms)
+{
+	const struct io_config *io = msp430_gpio_get_port(gpio);
+	const uint16_t port = GPIO_PORT(gpio);
+	const uint8_t pinmask = GPIO_PIN(gpio);
+	const uint32_t timeout =
+		((uint32_t)timeout_ms * TIME_TICKS_PER_SECOND) / 1000;
+	const uint32_t start = time_ticks();
+	int stat;
+
+	if (io->intenable == NULL) {
+		for (;;) {
+			if (!(*io->in & pinmask) == !value)
+				return 0;
+
+			if (!timeout_ms--)
+				return -1;
+
+			mdelay(1);
+		}
+	}
+
+	if (value)
+		*io->edge &= ~pinmask;
+	else
+		*io->edge |= pinmask;
+
+	for (;;) {
+		const uint32_t elapsed = time_ticks() - start;
+
+		msp430_gpio_events[port] &= ~pinmask;
+		*io->intflag &= ~pinmask;
+		*io->intenable |= pinmask;
+
+		/* the edge may have happened before the interrupt was enabled,
+		 * and a glitch may have triggered it so check the level */
+		if (!(*io->in & pinmask) == !value) {
+			stat = 0;
+			break;
+		}
+
+		if (elapsed >= timeout) {
+			stat = -1;
+			break;
+		}
+
+		time_wait_flag(&msp430_gpio_events[port], pinmask,
+			       (timeout - elapsed));
+	}
+
+	*io->intenable &= ~pinmask;
+
+	return stat;
+}
+
 int msp430_gpio_init(struct pl_gpio *gpio)
 {
 	gpio->config = msp430_gpio_config;
 	gpio->get = msp430_gpio_get;
 	gpio->set = msp430_gpio_set;
+	gpio->wait = msp430_gpio_wait;
 
 	return 0;
 }
 
+/* ----------------------------------------------------------------------------
+ * interrupt handlers
+ */
+
+/* These are the only port 1 and 2 ISRs, the pins connected to the CC2520 HAL
+ * with halDigioIntConnect() are dispatched to it and stay enabled. */
+#pragma vector=PORT1_VECTOR
+__interrupt void PORT1_ISR(void)
+{
+	const uint8_t flags = P1IFG & P1IE;
+	const uint8_t hal = halDigioIntDispatch(1, flags);
+
+	P1IFG &= ~flags;
+	P1IE &= ~(flags & ~hal);
+	msp430_gpio_events[0] |= flags & ~hal;
+	LPM4_EXIT;
+}
+
+#pragma vector=PORT2_VECTOR
+__interrupt void PORT2_ISR(void)
+{
+	const uint8_t flags = P2IFG & P2IE;
+	const uint8_t hal = halDigioIntDispatch(2, flags);
+
+	P2IFG &= ~flags;
+	P2IE &= ~(flags & ~hal);
+	msp430_gpio_events[1] |= flags & ~hal;
+	LPM4_EXIT;
+}
+
 /* ----------------------------------------------------------------------------
  * private functions
  */
@@ -19,6 +19,9 @@
 /*
  * msp430-i2c.c -- MSP430 i2c interface driver
  *
+ * Transfers are queued and run by the USCI interrupt handler, the pl_i2c
+ * read and write functions submit one and sleep until it has completed.
+ *
  * Authors:
  *   Nick Terry <nick.terry@plasticlogic.com>
  *   Guillaume Tucker <guillaume.tucker@plasticlogic.com>
@@ -31,8 +34,10 @@
 #include <stdint.h>
 #include "utils.h"
 #include "assert.h"
+#include "msp430-clock.h"
 #include "msp430-defs.h"
 #include "msp430-gpio.h"
+#include "msp430-i2c.h"
 
 #define CONFIG_PLAT_RUDDOCK2	1
 
@@ -60,13 +65,245 @@
  * mode (100kbps)
  *
  * The implication being that clock frequencies from 50Khz to 100Khz are not reliable.
+ *
+ * Only 400kHz (default) and 1MHz can be selected with pl_i2c_set_speed().
+ * Fast-mode Plus is beyond the MSP430F5438 datasheet and relies on the bus
+ * pull-ups, so it should be probed before being used.
  */
-#define SCL_CLOCK_DIV 50					// SCL clock divider
+#define SCL_DEFAULT_KHZ 400
+
+/* Smallest divider the USCI supports in I2C master mode */
+#define SCL_MIN_DIV 4
+
+/* SCL clock divider with the full SMCLK speed */
+static uint8_t i2c_scl_div = CPU_CLOCK_SPEED_IN_HZ / (SCL_DEFAULT_KHZ * 1000L);
+
+/* Maximum number of loops to wait for START or STOP to be sent, at least a
+ * byte time with the slowest SCL */
+#define COND_LOOPS 1000
 
 static int msp430_i2c_write(struct pl_i2c *i2c, uint8_t i2c_addr,
 			    const uint8_t *data, uint8_t count, uint8_t flags);
 static int msp430_i2c_read(struct pl_i2c *i2c, uint8_t i2c_addr,
 			   uint8_t *data, uint8_t count, uint8_t flags);
+static int msp430_i2c_set_speed(struct pl_i2c *i2c, unsigned khz);
+static void msp430_i2c_kick(void);
+
+/* The head of the queue is the current transfer once started */
+static struct msp430_i2c_xfer *i2c_queue;
+static uint8_t i2c_active;		// head transfer started
+static uint8_t i2c_held;		// bus kept without STOP for a continuation
+static uint8_t i2c_suspended;		// clock change in progress
+static const uint8_t *i2c_tx;
+static uint8_t *i2c_rx;
+static uint16_t i2c_tx_left;
+static uint16_t i2c_rx_left;
+static struct time_timer i2c_timer;
+
+/* The transfers are held while changing the clock so the bus is always idle
+ * when the divider is changed */
+static void msp430_i2c_clock_quiesce(void)
+{
+	__disable_interrupt();
+
+	/* only the caller holding the bus could release it */
+	assert(!i2c_held);
+
+	i2c_suspended = 1;
+
+	for (;;) {
+		__disable_interrupt();
+
+		if (!i2c_active)
+			break;
+
+		__bis_SR_register(LPM0_bits | GIE);	// Woken up on completion
+	}
+
+	__enable_interrupt();
+}
+
+static void msp430_i2c_clock_notify(enum msp430_clock_speed speed)
+{
+	uint16_t div = msp430_clock_div(i2c_scl_div);
+
+	/* 1MHz can not be reached with the idle clock, use the fastest rate */
+	if (div < SCL_MIN_DIV)
+		div = SCL_MIN_DIV;
+
+	UCxnCTL1 |= UCSWRST;
+	UCxnBR0 = div;
+	UCxnCTL1 &= ~UCSWRST;
+
+	i2c_suspended = 0;
+	msp430_i2c_kick();
+}
+
+static struct msp430_clock_notifier i2c_clock_notifier = {
+	NULL, msp430_i2c_clock_notify, msp430_i2c_clock_quiesce
+};
+
+static int msp430_i2c_wait_cond(uint8_t cond)
+{
+	unsigned loops;
+
+	for (loops = COND_LOOPS; loops; --loops)
+		if (!(UCxnCTL1 & cond))
+			return 0;
+
+	return -1;
+}
+
+/* All the private functions below must be called with interrupts disabled */
+
+static void msp430_i2c_complete(int8_t status)
+{
+	struct msp430_i2c_xfer *x = i2c_queue;
+
+	time_timer_cancel(&i2c_timer);
+	i2c_queue = x->next;
+	i2c_active = 0;
+	x->next = NULL;
+	x->status = status;
+
+	if (x->callback != NULL)
+		x->callback(x);
+}
+
+/* End of the data, the STOP for a read has already been requested */
+static void msp430_i2c_end(struct msp430_i2c_xfer *x, int tx)
+{
+	UCxnIE = 0;
+
+	if (x->flags & PL_I2C_NO_STOP) {
+		i2c_held = 1;
+	} else if (tx) {
+		UCxnCTL1 |= UCTXSTP;
+		UCxnIFG &= ~UCTXIFG;
+	}
+
+	msp430_i2c_complete(MSP430_I2C_DONE);
+}
+
+static void msp430_i2c_abort(void)
+{
+	UCxnIE = 0;
+	UCxnCTL1 |= UCTXSTP;
+	msp430_i2c_wait_cond(UCTXSTP);
+	UCxnCTL1 |= UCSWRST;
+	UCxnCTL1 &= ~UCSWRST;
+	i2c_held = 0;
+}
+
+static void msp430_i2c_timeout(struct time_timer *t)
+{
+	if (!i2c_active)
+		return;
+
+	msp430_i2c_abort();
+	msp430_i2c_complete(MSP430_I2C_ERROR);
+	msp430_i2c_kick();
+}
+
+static void msp430_i2c_start_rx(const struct msp430_i2c_xfer *x)
+{
+	UCxnIFG &= ~(UCTXIFG | UCRXIFG);
+	UCxnCTL1 &= ~UCTR;                      // UCTR=0 => Receive Mode (R/W bit = 1)
+	UCxnCTL1 |= UCTXSTT;                    // (Repeated) start
+	UCxnIE = UCRXIE | UCNACKIE;
+
+	// A single byte needs the STOP to be requested as soon as the START
+	// has been sent or the next byte will be read as well
+	if ((i2c_rx_left == 1) && !(x->flags & PL_I2C_NO_STOP)) {
+		msp430_i2c_wait_cond(UCTXSTT);
+		UCxnCTL1 |= UCTXSTP;
+	}
+}
+
+static void msp430_i2c_start(struct msp430_i2c_xfer *x)
+{
+	const int cont = i2c_held && (x->flags & PL_I2C_NO_START);
+	const uint16_t n = x->tx_count + x->rx_count;
+
+	i2c_active = 1;
+	i2c_tx = x->tx;
+	i2c_tx_left = x->tx_count;
+	i2c_rx = x->rx;
+	i2c_rx_left = x->rx_count;
+
+	if (!n) {                               // no data but may want to stop
+		if (i2c_held && !(x->flags & PL_I2C_NO_STOP)) {
+			UCxnCTL1 |= UCTXSTP;
+			i2c_held = 0;
+		}
+
+		msp430_i2c_complete(MSP430_I2C_DONE);
+		return;
+	}
+
+	i2c_timer.callback = msp430_i2c_timeout;
+	time_timer_add(&i2c_timer,
+		       TIME_MS_TO_TICKS(MSP430_I2C_TIMEOUT_MS + (n >> 3)));
+
+	if (cont) {
+		const int tx = (UCxnCTL1 & UCTR) ? 1 : 0;
+
+		i2c_held = 0;
+
+		// The direction can only change with a (repeated) START
+		if (tx != (i2c_tx_left ? 1 : 0)) {
+			msp430_i2c_abort();
+			msp430_i2c_complete(MSP430_I2C_ERROR);
+			return;
+		}
+
+		if (tx) {
+			// TXIFG was cleared by reading UCxnIV at the end of the
+			// previous transfer and SCL is held until TXBUF is
+			// loaded, so send the first byte now
+			--i2c_tx_left;
+			UCxnTXBUF = *i2c_tx++;
+			UCxnIE = UCTXIE | UCNACKIE;
+		} else {
+			// The next byte is clocked in once RXBUF has been read,
+			// so RXIFG is raised without any further action
+			if ((i2c_rx_left == 1) && !(x->flags & PL_I2C_NO_STOP))
+				UCxnCTL1 |= UCTXSTP;
+			UCxnIE = UCRXIE | UCNACKIE;
+		}
+
+		return;
+	}
+
+	// A START while holding the bus is a repeated start
+	if (!i2c_held)
+		msp430_i2c_wait_cond(UCTXSTP);  // Previous STOP still going
+
+	i2c_held = 0;
+	UCxnI2CSA = x->addr;                    // set Slave Address
+	UCxnIFG &= ~UCNACKIFG;
+
+	if (!i2c_tx_left) {
+		msp430_i2c_start_rx(x);
+		return;
+	}
+
+	UCxnCTL1 |= UCTR | UCTXSTT;             // Transmit mode and start, TXIFG
+	UCxnIE = UCTXIE | UCNACKIE;             // is set to load the first byte
+}
+
+static void msp430_i2c_kick(void)
+{
+	struct msp430_i2c_xfer *x;
+
+	while (!i2c_active && !i2c_suspended && ((x = i2c_queue) != NULL)) {
+		// only a blocking transfer can continue a held transaction
+		if (i2c_held && (x->callback != NULL))
+			break;
+
+		msp430_i2c_start(x);
+	}
+}
 
 /*
  *   Initialization of the I2C Module.
@@ -89,7 +326,7 @@ int msp430_i2c_init(struct pl_gpio *gpio, uint8_t channel, struct pl_i2c *i2c)
 	UCxnCTL1 |= UCSWRST;                    // Enable SW reset
 	UCxnCTL0 = UCMST | UCMODE_3 | UCSYNC;   // I2C Master, synchronous mode
 	UCxnCTL1 = UCSSEL_2 | UCTR | UCSWRST;   // Use SMCLK, TX mode, keep SW reset
-	UCxnBR0 = SCL_CLOCK_DIV;                // fSCL = SMCLK/N = ~400kHz
+	UCxnBR0 = i2c_scl_div;                  // fSCL = SMCLK/N = ~400kHz
 	UCxnBR1 = 0;
 	UCxnI2COA = 0x01A5;                     // own address (no general call)
 	UCxnIE = 0;								// disable all interrupts
@@ -106,148 +343,166 @@ int msp430_i2c_init(struct pl_gpio *gpio, uint8_t channel, struct pl_i2c *i2c)
 		assert(!(UCxnSTAT & UCBBUSY));
 	}
 
+	i2c_queue = NULL;
+	i2c_active = 0;
+	i2c_held = 0;
+	i2c_suspended = 0;
+
 	i2c->read = msp430_i2c_read;
 	i2c->write = msp430_i2c_write;
+	i2c->set_speed = msp430_i2c_set_speed;
 	i2c->priv = NULL;
+	i2c->khz = CPU_CLOCK_SPEED_IN_HZ / (i2c_scl_div * 1000L);
+
+	msp430_clock_register(&i2c_clock_notifier);
 
 	return 0;
 }
 
-/*
- * Write bytes to specified device - optional start and stop
- * First byte has to be preloaded for start to complete
- */
-static int msp430_i2c_write(struct pl_i2c *i2c, uint8_t i2c_addr,
-			    const uint8_t *data, uint8_t count, uint8_t flags)
+void msp430_i2c_submit(struct msp430_i2c_xfer *x)
 {
-	int result = -1;
-	int timeout = 0;
-	unsigned int gie = __get_SR_register() & GIE; //Store current GIE state
+	unsigned int gie = __get_SR_register() & GIE;
+	struct msp430_i2c_xfer **it;
 
-	__disable_interrupt();              	// Make this operation atomic
+	assert(x != NULL);
 
-	if (count == 0)							// no data but may want to stop
-		goto no_data;
+	__disable_interrupt();
 
-	if (!(flags & PL_I2C_NO_START))
-	{
-		UCxnI2CSA  = i2c_addr;        		// set Slave Address
+	x->status = MSP430_I2C_PENDING;
 
-		UCxnIFG = 0;						// clear all interrupt flags
-		UCxnCTL1 |= UCTR;                   // UCTR=1 => Transmit Mode (R/W bit = 0)
-		UCxnCTL1 |= UCTXSTT;				// Transmit start
+	// The continuation of a held transaction goes first, it can only be
+	// submitted by the caller which is holding the bus
+	if (i2c_held && (x->callback == NULL)) {
+		x->next = i2c_queue;
+		i2c_queue = x;
+	} else {
+		x->next = NULL;
 
-		UCxnTXBUF = *data++;				// preload first byte
-		count--;
-
-		while (UCxnCTL1 & UCTXSTT){			// wait for START to complete
-			timeout++;
-			if(timeout > 1000){
-				return -1;
-			}
-		}
+		for (it = &i2c_queue; *it != NULL; it = &(*it)->next);
 
-		if (UCxnIFG & UCNACKIFG)			// bail if NACK'd
-			goto error;
+		*it = x;
 	}
 
-	while (count--)
-	{
-		while ((UCxnIFG & UCTXIFG) == 0) {	// Wait for ok to send next byte
-			if (UCxnIFG & UCNACKIFG)		// see if last byte was NACK'd
-				goto error;
-		}
-		UCxnTXBUF = *data++;				// send the next byte
-	}
+	msp430_i2c_kick();
 
-	while ((UCxnIFG & UCTXIFG) == 0);		// Wait for last byte to clear
+	__bis_SR_register(gie);
+}
 
-no_data:
-	result = 0;
+int msp430_i2c_wait(struct msp430_i2c_xfer *x)
+{
+	for (;;) {
+		__disable_interrupt();
 
-	// suppress stop if requested
-	if (!(flags & PL_I2C_NO_STOP))
-	{
-error:
-		UCxnCTL1 |= UCTXSTP;				// Transmit Stop
-		while (UCxnCTL1 & UCTXSTP);      	// Ensure stop condition got sent
+		if (x->status != MSP430_I2C_PENDING)
+			break;
+
+		__bis_SR_register(LPM0_bits | GIE);	// SMCLK keeps running
 	}
 
-	__bis_SR_register(gie);             	// Restore original GIE state
+	__enable_interrupt();
+
+	return (x->status == MSP430_I2C_DONE) ? 0 : -1;
+}
+
+static int msp430_i2c_transfer(uint8_t i2c_addr, const uint8_t *tx,
+			       uint8_t *rx, uint8_t count, uint8_t flags)
+{
+	struct msp430_i2c_xfer x;
+
+	x.tx = tx;
+	x.tx_count = (tx != NULL) ? count : 0;
+	x.rx = rx;
+	x.rx_count = (rx != NULL) ? count : 0;
+	x.addr = i2c_addr;
+	x.flags = flags;
+	x.callback = NULL;
+	x.data = NULL;
+
+	msp430_i2c_submit(&x);
 
-	return result;
+	return msp430_i2c_wait(&x);
+}
+
+/*
+ * Write bytes to specified device - optional start and stop
+ */
+static int msp430_i2c_write(struct pl_i2c *i2c, uint8_t i2c_addr,
+			    const uint8_t *data, uint8_t count, uint8_t flags)
+{
+	return msp430_i2c_transfer(i2c_addr, data, NULL, count, flags);
 }
 
 /*
  * Read bytes from specified device - optional start and stop
- * There is an issue with receiving a single byte. We must
- * issue the stop before we even get the byte. Suspect emptying the
- * rx data buffer triggers the next read operation.
  */
 static int msp430_i2c_read(struct pl_i2c *i2c, uint8_t i2c_addr, uint8_t *data,
 			   uint8_t count, uint8_t flags)
 {
-	int result = -1;
-	int remaining = count;
-	int send_stop;
-	int stop_sent = 0;
-	unsigned int gie = __get_SR_register() & GIE; // store current GIE state
-
-	__disable_interrupt();              	// Make this operation atomic
-
-	send_stop = (!(flags & PL_I2C_NO_STOP) && (count == 1));
-
-	if (count == 0)
-		goto no_data;
+	return msp430_i2c_transfer(i2c_addr, NULL, data, count, flags);
+}
 
-	if (!(flags & PL_I2C_NO_START))
-	{
-		UCxnI2CSA  = i2c_addr;         		// set Slave Address
+static int msp430_i2c_set_speed(struct pl_i2c *i2c, unsigned khz)
+{
+	if ((khz != 400) && (khz != 1000))
+		return -1;
 
-		UCxnIFG = 0;						// clear interrupt flags
-		UCxnCTL1 &= ~UCTR;                  // UCTR=0 => Receive Mode (R/W bit = 1)
-		UCxnCTL1 |= UCTXSTT;				// Transmit start
+	/* same as a clock change, with the bus idle */
+	msp430_i2c_clock_quiesce();
+	__disable_interrupt();
+	i2c_scl_div = CPU_CLOCK_SPEED_IN_HZ / (khz * 1000L);
+	msp430_i2c_clock_notify(msp430_clock_get_speed());
+	__enable_interrupt();
 
-		while (UCxnCTL1 & UCTXSTT);			// wait for START to complete
-		if (UCxnIFG & UCNACKIFG)			// bail if NACK'd
-			goto error;
+	return 0;
+}
 
-		// special case handling of single byte read in case timing critical
-		if (send_stop) {
-			UCxnCTL1 |= UCTXSTP;			// generate stop
-			while (UCxnCTL1 & UCTXSTP);     // Ensure stop condition got sent
+/* ----------------------------------------------------------------------------
+ * interrupt handler
+ */
 
-			while ((UCxnIFG & UCRXIFG) == 0);	// Wait for data ready
-			*data++ = UCxnRXBUF;				// read the byte (allows collection of next)
-			remaining--;
-			stop_sent = 1;
+#pragma vector=USCI_B1_VECTOR
+__interrupt void USCI_B1_ISR(void)
+{
+	struct msp430_i2c_xfer *x = i2c_queue;
+
+	switch (__even_in_range(UCxnIV, 12)) {
+	case USCI_I2C_UCNACKIFG:
+		if (!i2c_active)
+			break;
+		msp430_i2c_abort();
+		msp430_i2c_complete(MSP430_I2C_ERROR);
+		break;
+	case USCI_I2C_UCRXIFG:
+		if (!i2c_active || !i2c_rx_left) {
+			UCxnIE &= ~UCRXIE;
+			break;
 		}
-	}
-
-	while (remaining)
-	{
-		remaining--;
-		if (remaining == 0 && !(flags & PL_I2C_NO_STOP)) {
-			UCxnCTL1 |= UCTXSTP;			// generate stop
-			while(UCxnCTL1 & UCTXSTP);      // Ensure stop condition got sent
-			stop_sent = 1;
+		*i2c_rx++ = UCxnRXBUF;		// allows collection of next byte
+		if (--i2c_rx_left == 1) {
+			if (!(x->flags & PL_I2C_NO_STOP))
+				UCxnCTL1 |= UCTXSTP;	// stop after the last byte
+		} else if (!i2c_rx_left) {
+			msp430_i2c_end(x, 0);
 		}
-		while ((UCxnIFG & UCRXIFG) == 0);	// Wait for data ready
-		*data++ = UCxnRXBUF;				// read the byte (allows collection of next)
-	}
-
-no_data:
-	result = 0;
-
-	// suppress stop if requested or not already sent
-	if (!(flags & PL_I2C_NO_STOP) && !stop_sent)
-	{
-error:
-		UCxnCTL1 |= UCTXSTP;				// Transmit Stop
-		while(UCxnCTL1 & UCTXSTP);          // Ensure stop condition got sent
+		break;
+	case USCI_I2C_UCTXIFG:
+		if (!i2c_active) {
+			UCxnIE &= ~UCTXIE;
+			break;
+		}
+		if (i2c_tx_left) {
+			--i2c_tx_left;
+			UCxnTXBUF = *i2c_tx++;		// send the next byte
+		} else if (i2c_rx_left) {
+			msp430_i2c_start_rx(x);		// last byte sent, read now
+		} else {
+			msp430_i2c_end(x, 1);
+		}
+		break;
+	default:
+		break;
 	}
-	__bis_SR_register(gie);             	// Restore original GIE state
 
-	return result;
+	msp430_i2c_kick();
+	LPM0_EXIT;
 }
-
@@ -32,8 +32,48 @@
 
 struct pl_gpio;
 struct pl_i2c;
+struct msp430_i2c_xfer;
+
+/** Completion callback, called from the interrupt handler */
+typedef void (*msp430_i2c_cb_t)(struct msp430_i2c_xfer *x);
+
+/** Maximum time for a transfer: this plus 1ms every 8 bytes */
+#define MSP430_I2C_TIMEOUT_MS 10
+
+/** Transfer status */
+enum msp430_i2c_status {
+	MSP430_I2C_DONE = 0,
+	MSP430_I2C_PENDING = 1,
+	MSP430_I2C_ERROR = -1,	/* NACK or timeout */
+};
+
+/** Transaction descriptor, owned by the driver from msp430_i2c_submit()
+ * until its status is no longer MSP430_I2C_PENDING.  The tx bytes are
+ * written first, then the rx bytes are read after a repeated start.  The
+ * pl_i2c_flags are only for the blocking pl_i2c interface: a transfer with
+ * a callback must start and end the transaction itself.  */
+struct msp430_i2c_xfer {
+	struct msp430_i2c_xfer *next;
+	const uint8_t *tx;
+	uint8_t *rx;
+	uint16_t tx_count;
+	uint16_t rx_count;
+	uint8_t addr;			/* 7-bit I2C address */
+	uint8_t flags;			/* pl_i2c_flags */
+	volatile int8_t status;		/* enum msp430_i2c_status */
+	msp430_i2c_cb_t callback;	/* optional */
+	void *data;			/* for the callback */
+};
 
 extern int msp430_i2c_init(struct pl_gpio *gpio,
 			   uint8_t channel, struct pl_i2c *i2c);
 
+/** Queue a transfer, which starts as soon as the bus is free.  Transfers are
+ * run in order, this can be called from an interrupt handler. */
+extern void msp430_i2c_submit(struct msp430_i2c_xfer *x);
+
+/** Sleep in LPM0 until a transfer has completed, interrupts must be enabled.
+ * Return 0 if it succeeded or -1 if it failed. */
+extern int msp430_i2c_wait(struct msp430_i2c_xfer *x);
+
 #endif /* MSP430_I2C_H */
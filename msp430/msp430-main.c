@@ -48,7 +48,7 @@ static void board_init(void)
 	WDTCTL = WDTPW + WDTHOLD;				// Hold WDT
 	SetVCore(PMMCOREV_3);					// Set VCore = 1.9V for 20MHz clock
 
-	UCSCTL4 = SELM_4 | SELS_4 | SELA_1;		// MCLK = SMCLK = DCOCLKDIV = 20MHz /  ACLK = VLO = 10Khz
+	UCSCTL4 = SELM_4 | SELS_4 | SELA_2;		// MCLK = SMCLK = DCOCLKDIV = 20MHz /  ACLK = REFO = 32768Hz
 	UCSCTL3 |= SELREF_2;					// Set DCO FLL reference = REFO
 
 	__bis_SR_register(SCG0);				// Disable the FLL control loop
@@ -72,6 +72,8 @@ static void board_init(void)
 												// Clear XT2,XT1,DCO fault flags
 		SFRIFG1 &= ~OFIFG;                      // Clear fault flags
 	} while (SFRIFG1 & OFIFG);
+
+	time_init();							// Start the ACLK time base
 }
 
 int main(void)
@@ -26,10 +26,12 @@
 #include <pl/platform.h>
 #include <pl/gpio.h>
 #include "msp430.h"
+#include "msp430-clock.h"
 #include "msp430-defs.h"
 #include "utils.h"
 #include "assert.h"
 #include "msp430-gpio.h"
+#include "msp430-dma.h"
 #include "msp430-sdcard.h"
 
 #define USCI_UNIT	B
@@ -40,7 +42,29 @@
 #define	SD_SOMI                 MSP430_GPIO(3,2)
 #define	SD_CLK                  MSP430_GPIO(3,3)
 
+/* Frames of at least this many bytes are received using DMA, 0 to disable */
+#define SDCARD_DMA_MIN_SIZE     32
+
+/* SPI clock dividers at full speed */
+#define SDCARD_DIV_INIT         63
+#define SDCARD_DIV_FAST         1
+
 struct pl_platform *SDCard_plat = NULL;
+static uint8_t SDCard_div = SDCARD_DIV_INIT;
+
+/* Called with interrupts disabled and no DMA transfer in progress */
+static void SDCard_clockNotify(enum msp430_clock_speed speed)
+{
+    while (UCxnSTAT & UCBUSY) ;                 // Wait for all TX/RX to finish
+
+    UCxnCTL1 |= UCSWRST;
+    UCxnBR0 = msp430_clock_div(SDCard_div);
+    UCxnCTL1 &= ~UCSWRST;
+}
+
+static struct msp430_clock_notifier SDCard_clockNotifier = {
+    NULL, SDCard_clockNotify
+};
 
 void SDCard_uDelay(uint16_t usecs)
 {
@@ -67,23 +91,71 @@ void SDCard_init(void)
 	UCxnCTL0 |= (UCMST | UCSYNC | UCCKPL | UCMSB);
 
 	UCxnCTL1 |= UCSSEL_2;                     	// Use SMCLK, keep RESET
-    UCxnBR0 = 63;                           	// Initial SPI clock must be <400kHz
+    SDCard_div = SDCARD_DIV_INIT;
+    UCxnBR0 = msp430_clock_div(SDCard_div); 	// Initial SPI clock must be <400kHz
     UCxnBR1 = 0;                            	// f_UCxCLK = 20MHz/63 = 317kHz
 	UCxnIE = 0x00;								// disable all interrupts
 	UCxnCTL1 &= ~UCSWRST;                     	// **Release state machine from reset**
+
+	msp430_clock_register(&SDCard_clockNotifier);
 }
 
 void SDCard_fastMode(void)
 {
     UCxnCTL1 |= UCSWRST;                        // Put state machine in reset
-    UCxnBR0 = 1;                                // f_UCxCLK = 20MHz/1 = 20MHz
+    SDCard_div = SDCARD_DIV_FAST;
+    UCxnBR0 = msp430_clock_div(SDCard_div);     // f_UCxCLK = 20MHz/1 = 20MHz
     UCxnBR1 = 0;
     UCxnCTL1 &= ~UCSWRST;                       // Release USCI state machine
 }
 
+/* Receive a frame with two DMA channels working in lock-step: both are
+ * triggered by RXIFG, the higher priority one stores the received byte and
+ * the other one then writes the next dummy byte.  With only one byte in
+ * flight there is no risk of overrun, even when another channel is busy
+ * draining a buffer to the EPDC at the same time. */
+static void SDCard_readFrameDMA(uint8_t *pBuffer, uint16_t size)
+{
+    static const uint8_t dummy = 0xff;
+
+    DMACTL0 = (DMACTL0 & ~(MSP430_DMA0_TSEL_MASK | MSP430_DMA1_TSEL_MASK)) |
+        MSP430_DMA0_TSEL(MSP430_DMA_TRIG_UCB0RXIFG) |
+        MSP430_DMA1_TSEL(MSP430_DMA_TRIG_UCB0RXIFG);
+
+    DMA0CTL = 0;                                // RXBUF -> buffer
+    __data16_write_addr((unsigned short)&DMA0SA, (unsigned long)&UCxnRXBUF);
+    __data16_write_addr((unsigned short)&DMA0DA, (unsigned long)pBuffer);
+    DMA0SZ = size;
+    DMA0CTL = DMADT_0 | DMADSTINCR_3 | DMASRCINCR_0 |
+        DMADSTBYTE | DMASRCBYTE | DMAEN;
+
+    DMA1CTL = 0;                                // dummy -> TXBUF
+    __data16_write_addr((unsigned short)&DMA1SA, (unsigned long)&dummy);
+    __data16_write_addr((unsigned short)&DMA1DA, (unsigned long)&UCxnTXBUF);
+    DMA1SZ = size - 1;
+    DMA1CTL = DMADT_0 | DMADSTINCR_0 | DMASRCINCR_0 |
+        DMADSTBYTE | DMASRCBYTE | DMAEN;
+
+    UCxnIFG &= ~UCRXIFG;                        // Ensure RXIFG is clear
+    while (!(UCxnIFG & UCTXIFG)) ;
+    UCxnTXBUF = dummy;                          // First byte starts the chain
+
+    while (!(DMA0CTL & DMAIFG)) ;               // Wait for the last byte
+
+    DMA0CTL &= ~(DMAIFG | DMAEN);
+    DMA1CTL &= ~(DMAIFG | DMAEN);
+}
+
 void SDCard_readFrame(uint8_t *pBuffer, uint16_t size)
 {
-    uint16_t gie = __get_SR_register() & GIE;   // Store current GIE state
+    uint16_t gie;
+
+    if (SDCARD_DMA_MIN_SIZE && (size >= SDCARD_DMA_MIN_SIZE)) {
+        SDCard_readFrameDMA(pBuffer, size);
+        return;
+    }
+
+    gie = __get_SR_register() & GIE;            // Store current GIE state
 
     __disable_interrupt();                      // Make this operation atomic
 
@@ -28,7 +28,9 @@
 #include <msp430.h>
 #include "utils.h"
 #include "assert.h"
+#include "msp430-clock.h"
 #include "msp430-defs.h"
+#include "msp430-dma.h"
 #include "msp430-spi.h"
 #include "msp430-gpio.h"
 
@@ -46,6 +48,31 @@
 
 int msp430_spi_read_bytes(uint8_t *buff, uint8_t size);
 int msp430_spi_write_bytes(uint8_t *buff, uint8_t size);
+int msp430_spi_dma_write(const uint8_t *buff, uint16_t size);
+int msp430_spi_dma_wait(void);
+
+static uint16_t spi_divisor;
+
+static void msp430_spi_set_divisor(uint16_t divisor)
+{
+    UCxnBR0 = (divisor & 0x00ff);
+    UCxnBR1 = ((divisor >> 8) & 0x00ff);
+}
+
+/* Called with interrupts disabled and no DMA transfer in progress */
+static void msp430_spi_clock_notify(enum msp430_clock_speed speed)
+{
+	while (UCxnSTAT & UCBUSY) ;                 // Wait for all TX/RX to finish
+
+	UCxnCTL1 |= UCSWRST;
+	msp430_spi_set_divisor(msp430_clock_div(spi_divisor));
+	UCxnCTL1 &= ~UCSWRST;
+}
+
+static struct msp430_clock_notifier spi_clock_notifier = {
+	NULL, msp430_spi_clock_notify
+};
+
 /* We only support a single SPI bus and that bus is defined at compile
  * time.
  */
@@ -69,14 +96,22 @@ int msp430_spi_init(struct pl_gpio *gpio, uint8_t spi_channel, uint16_t divisor,
 	UCxnCTL0 |= (UCMST | UCSYNC | UCMSB | UCCKPH);
 
 	UCxnCTL1 |= UCSSEL_2;					// SMCLK is selected
-    UCxnBR0 = (divisor & 0x00ff);			// f_UCxCLK = 20MHz/1 = 20MHz
-    UCxnBR1 = ((divisor >> 8) & 0x00ff);	//
+	spi_divisor = divisor;
+	msp430_spi_set_divisor(divisor);		// f_UCxCLK = 20MHz/1 = 20MHz
 	UCxnIE = 0x00;							// All interrupts disabled
 
 	UCxnCTL1 &= ~UCSWRST;                  	// Release state machine from reset
 
 	iface->read = msp430_spi_read_bytes;
 	iface->write = msp430_spi_write_bytes;
+	iface->dma_write = msp430_spi_dma_write;
+	iface->dma_wait = msp430_spi_dma_wait;
+
+	DMACTL1 = (DMACTL1 & ~MSP430_DMA2_TSEL_MASK) |
+		MSP430_DMA2_TSEL(MSP430_DMA_TRIG_UCA0TXIFG);
+	DMA2CTL = 0;
+
+	msp430_clock_register(&spi_clock_notifier);
 
 	return 0;
 }
@@ -129,4 +164,34 @@ int msp430_spi_write_bytes(uint8_t *buff, uint8_t size)
     return 0;
 }
 
+int msp430_spi_dma_write(const uint8_t *buff, uint16_t size)
+{
+	if (!size)
+		return 0;
+
+	DMA2CTL = 0;
+	__data16_write_addr((unsigned short)&DMA2SA, (unsigned long)buff);
+	__data16_write_addr((unsigned short)&DMA2DA, (unsigned long)&UCxnTXBUF);
+	DMA2SZ = size;
+	DMA2CTL = DMADT_0 | DMADSTINCR_0 | DMASRCINCR_3 |
+		DMADSTBYTE | DMASRCBYTE | DMAEN;
+
+	// TXIFG is already set so toggle it to create the first trigger edge,
+	// the receive buffer overruns are dealt with in msp430_spi_dma_wait()
+	UCxnIFG &= ~UCTXIFG;
+	UCxnIFG |= UCTXIFG;
+
+	return 0;
+}
 
+int msp430_spi_dma_wait(void)
+{
+	while (DMA2CTL & DMAEN) ;                   // Cleared at the end of the block
+	DMA2CTL &= ~DMAIFG;
+
+	while (UCxnSTAT & UCBUSY) ;                 // Wait for all TX/RX to finish
+
+	UCxnRXBUF;                                  // Dummy read to empty RX buffer
+	                                            // and clear any overrun conditions
+	return 0;
+}
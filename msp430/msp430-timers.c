@@ -26,19 +26,39 @@
 #include <msp430.h>
 #include <stdint.h>
 #include "utils.h"
+#include "msp430-clock.h"
 #include "msp430-gpio.h"
 
 #define INIT_COUNT_L 0xC3
 #define INIT_COUNT_H 0x50
 
-static int delay;
+/* Counter overflows, 32 bits so the microsecond time only wraps around
+ * after 2^32 us instead of when the tick count does */
+static volatile uint32_t time_overflows;
 
 #define CPU_CYCLES_PER_USECOND (CPU_CLOCK_SPEED_IN_HZ/1000000L)
 #define CPU_CYCLES_PER_MSECOND (CPU_CLOCK_SPEED_IN_HZ/1000L)
+#define IDLE_CYCLES_PER_USECOND \
+	(CPU_CYCLES_PER_USECOND >> MSP430_CLOCK_IDLE_SHIFT)
+#define IDLE_CYCLES_PER_MSECOND \
+	(CPU_CYCLES_PER_MSECOND >> MSP430_CLOCK_IDLE_SHIFT)
+
+/* Only go to idle clock speed for sleeps at least this long */
+#define IDLE_MIN_MS 10
+
+/* Minimum compare distance, in case the counter runs past it while
+ * programming TA1CCR1 or TA1CCR2 */
+#define TIME_MIN_DELTA 2
 
 /* Functions for delay/sleep. Needs to be calibrated */
 void udelay(uint16_t us)
 {
+	if (msp430_clock_get_speed() == MSP430_CLOCK_IDLE) {
+		while (us--)
+			__delay_cycles(IDLE_CYCLES_PER_USECOND);
+		return;
+	}
+
 	while (us--)
 	{
 		__delay_cycles(CPU_CYCLES_PER_USECOND);
@@ -47,17 +67,287 @@ void udelay(uint16_t us)
 
 void mdelay(uint16_t ms)
 {
+	if (msp430_clock_get_speed() == MSP430_CLOCK_IDLE) {
+		while (ms--)
+			__delay_cycles(IDLE_CYCLES_PER_MSECOND);
+		return;
+	}
+
     while (ms--)
     {
         __delay_cycles(CPU_CYCLES_PER_MSECOND);
     }
 }
 
+/* The time base is Timer1_A in continuous mode, clocked from ACLK and extended
+ * to 32 bits with its overflow interrupt */
+void time_init(void)
+{
+	time_overflows = 0;
+	TA1CTL = TASSEL_1 | ID_0 | MC_2 | TACLR | TAIE;	// ACLK, contmode, overflow interrupt
+}
+
+/* Read the counter and the number of overflows consistently */
+static uint16_t time_read(uint32_t *overflows)
+{
+	unsigned int gie = __get_SR_register() & GIE;
+	uint32_t hi;
+	uint16_t lo, lo2;
+
+	__disable_interrupt();
+
+	/* The timer clock is asynchronous to MCLK, read until stable */
+	lo = TA1R;
+	while ((lo2 = TA1R) != lo)
+		lo = lo2;
+
+	hi = time_overflows;
+
+	/* Account for an overflow which has not been serviced yet */
+	if ((TA1CTL & TAIFG) && (lo < 0x8000))
+		++hi;
+
+	__bis_SR_register(gie);
+
+	*overflows = hi;
+
+	return lo;
+}
+
+uint32_t time_ticks(void)
+{
+	uint32_t hi;
+	const uint16_t lo = time_read(&hi);
+
+	return (hi << 16) | lo;
+}
+
+/* 1000000 / 32768 = 15625 / 512, split to avoid 64-bit arithmetic */
+uint32_t pl_time_now_us(void)
+{
+	uint32_t hi;
+	const uint16_t lo = time_read(&hi);
+
+	return (((hi << 7) | (lo >> 9)) * 15625UL) +
+		(((uint32_t)(lo & 0x1FF) * 15625UL) >> 9);
+}
+
+uint32_t pl_time_since(uint32_t start_us)
+{
+	return pl_time_now_us() - start_us;
+}
+
+int time_wait_flag(volatile const uint8_t *flags, uint8_t mask,
+		   uint32_t timeout)
+{
+	const uint32_t start = time_ticks();
+	const int idle = (timeout >= TIME_MS_TO_TICKS(IDLE_MIN_MS));
+	int stat;
+
+	if (idle)
+		cpu_idle_begin();
+
+	for (;;) {
+		uint32_t now, delta;
+
+		__disable_interrupt();
+
+		if (*flags & mask) {
+			stat = 0;
+			break;
+		}
+
+		now = time_ticks();
+
+		if ((now - start) >= timeout) {
+			stat = -1;
+			break;
+		}
+
+		/* Wake up on the compare interrupt when the deadline is close
+		 * enough, otherwise on the next overflow */
+		delta = timeout - (now - start);
+
+		if (delta < 0x10000UL) {
+			if (delta < TIME_MIN_DELTA)
+				delta = TIME_MIN_DELTA;
+
+			TA1CCR1 = (uint16_t)(now + delta);
+			TA1CCTL1 = CCIE;		// Clears CCIFG
+		}
+
+		__bis_SR_register(LPM0_bits | GIE);	// Sleep until an interrupt
+	}
+
+	TA1CCTL1 = 0;
+	__enable_interrupt();
+
+	if (idle)
+		cpu_idle_end();
+
+	return stat;
+}
+
+/* Timers sorted by expiry time, the first one sets TA1CCR2.  This is
+ * tickless: the CPU only wakes up for the next expiry or a counter overflow
+ * when it is further away than the counter range. */
+static struct time_timer *time_timers;
+
+static int time_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+/* Must be called with interrupts disabled */
+static void time_arm(void)
+{
+	uint32_t now;
+	int32_t delta;
+
+	TA1CCTL2 = 0;
+
+	if (time_timers == NULL)
+		return;
+
+	now = time_ticks();
+	delta = time_timers->expires - now;
+
+	if (delta >= 0x10000L)
+		return;				// Next overflow will get closer
+
+	if (delta < TIME_MIN_DELTA)
+		delta = TIME_MIN_DELTA;
+
+	TA1CCR2 = (uint16_t)(now + delta);
+	TA1CCTL2 = CCIE;
+}
+
+/* Must be called with interrupts disabled */
+static void time_run_timers(void)
+{
+	const uint32_t now = time_ticks();
+
+	while ((time_timers != NULL) && !time_before(now, time_timers->expires)) {
+		struct time_timer *t = time_timers;
+
+		time_timers = t->next;
+		t->next = NULL;
+		t->callback(t);
+	}
+
+	time_arm();
+}
+
+void time_timer_add(struct time_timer *t, uint32_t delay)
+{
+	unsigned int gie = __get_SR_register() & GIE;
+	struct time_timer **it;
+
+	__disable_interrupt();
+
+	t->expires = time_ticks() + delay;
+
+	for (it = &time_timers; *it != NULL; it = &(*it)->next)
+		if (time_before(t->expires, (*it)->expires))
+			break;
+
+	t->next = *it;
+	*it = t;
+
+	if (time_timers == t)
+		time_arm();
+
+	__bis_SR_register(gie);
+}
+
+int time_timer_cancel(struct time_timer *t)
+{
+	unsigned int gie = __get_SR_register() & GIE;
+	struct time_timer **it;
+	int stat = -1;
+
+	__disable_interrupt();
+
+	for (it = &time_timers; *it != NULL; it = &(*it)->next) {
+		if (*it == t) {
+			*it = t->next;
+			t->next = NULL;
+			time_arm();
+			stat = 0;
+			break;
+		}
+	}
+
+	__bis_SR_register(gie);
+
+	return stat;
+}
+
+static void msleep_expired(struct time_timer *t)
+{
+	*(volatile uint8_t *)t->data = 1;
+}
+
 void msleep(uint16_t ms)
 {
-	mdelay(ms);
+	volatile uint8_t done = 0;
+	struct time_timer t;
+
+	if (!ms)
+		return;
+
+	/* time base not running yet */
+	if (!(TA1CTL & MC_3)) {
+		mdelay(ms);
+		return;
+	}
+
+	if (ms >= IDLE_MIN_MS)
+		cpu_idle_begin();
+
+	t.callback = msleep_expired;
+	t.data = (void *)&done;
+	time_timer_add(&t, TIME_MS_TO_TICKS(ms));
+
+	for (;;) {
+		__disable_interrupt();
+
+		if (done)
+			break;
+
+		/* Only ACLK keeps running, any interrupt wakes up the CPU */
+		__bis_SR_register(LPM3_bits | GIE);
+	}
+
+	__enable_interrupt();
+
+	if (ms >= IDLE_MIN_MS)
+		cpu_idle_end();
 }
 
+#pragma vector = TIMER1_A1_VECTOR
+__interrupt void TIMER1_A1_ISR(void)
+{
+	switch(__even_in_range(TA1IV,14))
+	{
+	case TA1IV_TA1CCR1:
+		TA1CCTL1 &= ~CCIE;
+		LPM4_EXIT;
+		break;
+	case TA1IV_TA1CCR2:
+		time_run_timers();
+		LPM4_EXIT;
+		break;
+	case TA1IV_TA1IFG:
+		++time_overflows;
+		if (time_timers != NULL)
+			time_run_timers();
+		LPM4_EXIT;
+		break;
+	default:
+		break;
+	}
+}
 
 void init_rtc()
 {
@@ -99,43 +389,3 @@ __interrupt void RTC_ISR(void)
 
     __bis_SR_register(gie);
 }
-
-void timer_start(void)
-{
-	delay = 1;
-	TA0CTL = TASSEL_1 | ID_3 | MC_2 | TACLR | TAIE;         // ACK ( = 10kHz), contmode, clear interrupt enable
-	TA0R = 0xFFFF - 0x927C;									// Configure the timer
-}
-
-void timer_stop(void)
-{
-	TA0CTL = MC_0;
-}
-
-#pragma vector = TIMER0_A1_VECTOR
-__interrupt void TIMER0_ISR(void)
-{
-	unsigned int gie = __get_SR_register();
-
-	__disable_interrupt();
-
-	switch(__even_in_range(TA0IV,16))
-	{
-	case 0x0E:
-		delay--;
-		if(delay < 0)
-		{
-			timer_stop();
-			timer_start();
-		}
-
-		// reload the timer for 1 minute
-		TA0R = 0xFFFF - 0x927C;
-
-		break;
-	default:break;
-
-	}
-
-    __bis_SR_register(gie);
-}
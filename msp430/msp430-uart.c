@@ -30,6 +30,7 @@
 #include <file.h>
 #include "utils.h"
 #include "msp430.h"
+#include "msp430-clock.h"
 #include "msp430-defs.h"
 #include "msp430-uart.h"
 #include "msp430-gpio.h"
@@ -41,6 +42,69 @@
 #define	UART_TX                 MSP430_GPIO(5,6)
 #define	UART_RX                 MSP430_GPIO(5,7)
 
+struct uart_baud_rate {
+	uint8_t br0;
+	uint8_t br1;
+	uint8_t mctl;
+};
+
+/* These registers taken from Table 34-4 and 34-5 of the MSP430 Users guide,
+ * indexed by baud rate id.  They are dependent on a 20MHz clock.  */
+#if CPU_CLOCK_SPEED_IN_HZ != 20000000L
+#error CPU Clock speed not 20MHz - baud rate calculations not valid
+#endif
+static const struct uart_baud_rate uart_baud_full[] = {
+	{ 0, 0, 0 },
+	{ 130, 0, (UCOS16 | UCBRS_0 | UCBRF_3) },	// 9600
+	{ 65, 0, (UCOS16 | UCBRS_0 | UCBRF_2) },	// 19200
+	{ 32, 0, (UCOS16 | UCBRS_0 | UCBRF_9) },	// 38400
+	{ 21, 0, (UCOS16 | UCBRS_0 | UCBRF_11) },	// 57600
+	{ 10, 0, (UCOS16 | UCBRS_0 | UCBRF_14) },	// 115200
+	{ 5, 0, (UCOS16 | UCBRS_0 | UCBRF_7) },		// 230400
+};
+
+/* Same with the 2.5MHz idle clock, using low-frequency baud rate generation
+ * as the oversampling mode needs a divider of at least 16 */
+#if MSP430_CLOCK_IDLE_SHIFT != 3
+#error Idle baud rate calculations not valid
+#endif
+static const struct uart_baud_rate uart_baud_idle[] = {
+	{ 0, 0, 0 },
+	{ 4, 1, UCBRS_3 },				// 9600
+	{ 130, 0, UCBRS_2 },				// 19200
+	{ 65, 0, UCBRS_1 },				// 38400
+	{ 43, 0, UCBRS_3 },				// 57600
+	{ 21, 0, UCBRS_6 },				// 115200
+	{ 10, 0, UCBRS_7 },				// 230400
+};
+
+static int uart_baud_rate_id;
+
+static void msp430_uart_set_baud_rate(enum msp430_clock_speed speed)
+{
+	const struct uart_baud_rate *br = (speed == MSP430_CLOCK_IDLE) ?
+		&uart_baud_idle[uart_baud_rate_id] :
+		&uart_baud_full[uart_baud_rate_id];
+
+	UCxnBR0 = br->br0;
+	UCxnBR1 = br->br1;
+	UCxnMCTL = br->mctl;
+}
+
+/* Called with interrupts disabled */
+static void msp430_uart_clock_notify(enum msp430_clock_speed speed)
+{
+	while (UCxnSTAT & UCBUSY) ;		// Wait for the last character
+
+	UCxnCTL1 |= UCSWRST;
+	msp430_uart_set_baud_rate(speed);
+	UCxnCTL1 &= ~UCSWRST;
+}
+
+static struct msp430_clock_notifier uart_clock_notifier = {
+	NULL, msp430_uart_clock_notify
+};
+
 #if CONFIG_UART_PRINTF
 // protect from calls before intialisation is complete.
 static uint8_t init_done = 0;
@@ -168,48 +232,12 @@ int msp430_uart_init(struct pl_gpio *gpio, int baud_rate_id, char parity,
 			return -1;
 	}
 
-	/* These registers taken from Table 34-4 and 34-5 of the
-	 * MSP430 Users guide.
-	 * They are dependent on a 20MHz clock
-	 */
-#if CPU_CLOCK_SPEED_IN_HZ != 20000000L
-#error CPU Clock speed not 20MHz - baud rate calculations not valid
-#endif
-	switch (baud_rate_id)
-	{
-		case BR_9600:
-			UCxnBR0 = 130;
-			UCxnBR1 = 0;
-			UCxnMCTL = (UCOS16 | UCBRS_0 | UCBRF_3);
-			break;
-		case BR_19200:
-			UCxnBR0 = 65;
-			UCxnBR1 = 0;
-			UCxnMCTL = (UCOS16 | UCBRS_0 | UCBRF_2);
-			break;
-		case BR_38400:
-			UCxnBR0 = 32;
-			UCxnBR1 = 0;
-			UCxnMCTL = (UCOS16 | UCBRS_0 | UCBRF_9);
-			break;
-		case BR_57600:
-			UCxnBR0 = 21;
-			UCxnBR1 = 0;
-			UCxnMCTL = (UCOS16 | UCBRS_0 | UCBRF_11);
-			break;
-		case BR_115200:
-			UCxnBR0 = 10;
-			UCxnBR1 = 0;
-			UCxnMCTL = (UCOS16 | UCBRS_0 | UCBRF_14);
-			break;
-		case BR_230400:
-			UCxnBR0 = 5;
-			UCxnBR1 = 0;
-			UCxnMCTL = (UCOS16 | UCBRS_0 | UCBRF_7);
-			break;
-		default:
-			return -1;
-	}
+	if ((baud_rate_id < BR_9600) || (baud_rate_id > BR_230400))
+		return -1;
+
+	uart_baud_rate_id = baud_rate_id;
+	msp430_uart_set_baud_rate(msp430_clock_get_speed());
+	msp430_clock_register(&uart_clock_notifier);
 
 	// release unit from reset
 	UCxnCTL1 &= ~UCSWRST;
@@ -0,0 +1,185 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * energy.c -- Time accounting for the EPD power phases
+ *
+ */
+
+#include <pl/energy.h>
+#include <pl/epdc.h>
+#include <string.h>
+#include "assert.h"
+
+#define LOG_TAG "energy"
+#include "utils.h"
+
+#if CONFIG_ENERGY
+
+/* Set to 1 to log each update */
+#define LOG_UPDATES 0
+
+static const char * const phase_names[PL_ENERGY_N_PHASES] = {
+	"psu-on", "hv-on", "update", "wait-update",
+	"run", "standby", "sleep", "off",
+};
+
+static struct pl_energy_stats energy_stats;
+static uint32_t energy_start[PL_ENERGY_N_PHASES];
+static uint16_t energy_running;
+
+/* Avoid overflows as the totals can be large */
+static uint32_t ticks_to_ms(uint32_t ticks)
+{
+	return ((ticks / TIME_TICKS_PER_SECOND) * 1000) +
+		(((ticks % TIME_TICKS_PER_SECOND) * 1000) /
+		 TIME_TICKS_PER_SECOND);
+}
+
+void pl_energy_begin(enum pl_energy_phase phase)
+{
+	const uint16_t mask = 1 << phase;
+
+	assert(phase < PL_ENERGY_N_PHASES);
+
+	if (energy_running & mask)
+		return;
+
+	energy_start[phase] = time_ticks();
+	energy_running |= mask;
+	++energy_stats.count[phase];
+}
+
+void pl_energy_end(enum pl_energy_phase phase)
+{
+	const uint16_t mask = 1 << phase;
+
+	assert(phase < PL_ENERGY_N_PHASES);
+
+	if (!(energy_running & mask))
+		return;
+
+	energy_stats.ticks[phase] += time_ticks() - energy_start[phase];
+	energy_running &= ~mask;
+}
+
+void pl_energy_power_state(int state)
+{
+	int i;
+
+	assert((state >= PL_EPDC_RUN) && (state <= PL_EPDC_OFF));
+
+	for (i = PL_ENERGY_EPDC_RUN; i <= PL_ENERGY_EPDC_OFF; ++i)
+		if (i != (PL_ENERGY_EPDC_RUN + state))
+			pl_energy_end(i);
+
+	pl_energy_begin(PL_ENERGY_EPDC_RUN + state);
+}
+
+void pl_energy_update_begin(int wfid, int temp)
+{
+	struct pl_energy_update *u = &energy_stats.last;
+
+	u->wfid = wfid;
+	u->temp = temp;
+	u->time = time_ticks();
+	u->update_ticks = 0;
+	u->wait_ticks = 0;
+	pl_energy_begin(PL_ENERGY_UPDATE);
+}
+
+void pl_energy_update_sent(void)
+{
+	struct pl_energy_update *u = &energy_stats.last;
+
+	if (!(energy_running & (1 << PL_ENERGY_UPDATE)))
+		return;
+
+	pl_energy_end(PL_ENERGY_UPDATE);
+	u->update_ticks = time_ticks() - u->time;
+	pl_energy_begin(PL_ENERGY_WAIT_UPDATE);
+}
+
+void pl_energy_update_end(void)
+{
+	struct pl_energy_update *u = &energy_stats.last;
+
+	if (!(energy_running & (1 << PL_ENERGY_WAIT_UPDATE)))
+		return;
+
+	pl_energy_end(PL_ENERGY_WAIT_UPDATE);
+	u->wait_ticks = time_ticks() - u->time - u->update_ticks;
+
+	if ((u->wfid >= 0) && (u->wfid < PL_ENERGY_N_WFID)) {
+		++energy_stats.wf_count[u->wfid];
+		energy_stats.wf_ticks[u->wfid] += u->wait_ticks;
+	}
+
+#if LOG_UPDATES
+	LOG("update wfid=%d temp=%d: request %lu ms, waveform %lu ms",
+	    u->wfid, u->temp, ticks_to_ms(u->update_ticks),
+	    ticks_to_ms(u->wait_ticks));
+#endif
+}
+
+void pl_energy_get(struct pl_energy_stats *stats)
+{
+	const uint32_t now = time_ticks();
+	int i;
+
+	assert(stats != NULL);
+
+	memcpy(stats, &energy_stats, sizeof(*stats));
+
+	for (i = 0; i < PL_ENERGY_N_PHASES; ++i)
+		if (energy_running & (1 << i))
+			stats->ticks[i] += now - energy_start[i];
+}
+
+void pl_energy_reset(void)
+{
+	const uint32_t now = time_ticks();
+	int i;
+
+	memset(&energy_stats, 0, sizeof(energy_stats));
+	energy_stats.last.wfid = -1;
+
+	for (i = 0; i < PL_ENERGY_N_PHASES; ++i)
+		if (energy_running & (1 << i))
+			energy_start[i] = now;
+}
+
+void pl_energy_log(void)
+{
+	struct pl_energy_stats stats;
+	int i;
+
+	pl_energy_get(&stats);
+
+	for (i = 0; i < PL_ENERGY_N_PHASES; ++i)
+		if (stats.count[i])
+			LOG("%-12s %5u x, %8lu ms", phase_names[i],
+			    stats.count[i], ticks_to_ms(stats.ticks[i]));
+
+	for (i = 0; i < PL_ENERGY_N_WFID; ++i)
+		if (stats.wf_count[i])
+			LOG("wfid %-7d %5u x, %8lu ms", i, stats.wf_count[i],
+			    ticks_to_ms(stats.wf_ticks[i]));
+}
+
+#endif /* CONFIG_ENERGY */
@@ -0,0 +1,121 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * energy.h -- Time accounting for the EPD power phases
+ *
+ */
+
+#ifndef INCLUDE_PL_ENERGY_H
+#define INCLUDE_PL_ENERGY_H 1
+
+#include <stdint.h>
+#include "config.h"
+
+/**
+   @file pl/energy.h
+
+   Time spent with the HV rails on, in each part of an update and in each EPDC
+   power state, measured with the time base.  Multiplied by the current drawn
+   in each phase, this gives the energy used by each update.  Times are in
+   time base ticks and the totals wrap around after about 36 hours.
+*/
+
+/** Accounted phases, the EPDC power states are mutually exclusive */
+enum pl_energy_phase {
+	PL_ENERGY_PSU_ON = 0,	/**< turning the EPD PSU on */
+	PL_ENERGY_HV_ON,	/**< EPD PSU on, including keep-alive */
+	PL_ENERGY_UPDATE,	/**< sending an update request */
+	PL_ENERGY_WAIT_UPDATE,	/**< waiting for the end of an update */
+	PL_ENERGY_EPDC_RUN,	/**< PL_EPDC_RUN power state */
+	PL_ENERGY_EPDC_STANDBY,	/**< PL_EPDC_STANDBY power state */
+	PL_ENERGY_EPDC_SLEEP,	/**< PL_EPDC_SLEEP power state */
+	PL_ENERGY_EPDC_OFF,	/**< PL_EPDC_OFF power state */
+	PL_ENERGY_N_PHASES
+};
+
+/** Number of waveform ids accounted separately */
+#define PL_ENERGY_N_WFID 8
+
+/** Last update */
+struct pl_energy_update {
+	int wfid;		/**< waveform id */
+	int temp;		/**< temperature in degrees Celsius */
+	uint32_t time;		/**< time_ticks() at the start of the update */
+	uint32_t update_ticks;	/**< time to send the update request */
+	uint32_t wait_ticks;	/**< time until the end of the update */
+};
+
+/** Totals since the last reset */
+struct pl_energy_stats {
+	uint32_t ticks[PL_ENERGY_N_PHASES];  /**< time spent in each phase */
+	uint16_t count[PL_ENERGY_N_PHASES];  /**< number of times entered */
+	uint16_t wf_count[PL_ENERGY_N_WFID]; /**< updates for each waveform */
+	uint32_t wf_ticks[PL_ENERGY_N_WFID]; /**< wait time for each one */
+	struct pl_energy_update last;        /**< last completed update */
+};
+
+#if CONFIG_ENERGY
+
+/** Record the start of a phase, ignored if it is already running */
+extern void pl_energy_begin(enum pl_energy_phase phase);
+
+/** Record the end of a phase, ignored if it is not running */
+extern void pl_energy_end(enum pl_energy_phase phase);
+
+/** Record an EPDC power state change (enum pl_epdc_power_state) */
+extern void pl_energy_power_state(int state);
+
+/** Record the start of an update, before sending the request */
+extern void pl_energy_update_begin(int wfid, int temp);
+
+/** Record the end of the update request, the waveform is now running */
+extern void pl_energy_update_sent(void);
+
+/** Record the end of an update, once the waveform has completed */
+extern void pl_energy_update_end(void);
+
+/**
+   Get the totals, including the time spent so far in the running phases.
+
+   @param[out] stats totals since the last reset
+*/
+extern void pl_energy_get(struct pl_energy_stats *stats);
+
+/** Reset the totals, the running phases start again from now, also to be
+ * called once during initialisation */
+extern void pl_energy_reset(void);
+
+/** Log the totals in milliseconds */
+extern void pl_energy_log(void);
+
+#else
+
+#define pl_energy_begin(_phase) do {} while (0)
+#define pl_energy_end(_phase) do {} while (0)
+#define pl_energy_power_state(_state) do {} while (0)
+#define pl_energy_update_begin(_wfid, _temp) do {} while (0)
+#define pl_energy_update_sent() do {} while (0)
+#define pl_energy_update_end() do {} while (0)
+#define pl_energy_get(_stats) do {} while (0)
+#define pl_energy_reset() do {} while (0)
+#define pl_energy_log() do {} while (0)
+
+#endif /* CONFIG_ENERGY */
+
+#endif /* INCLUDE_PL_ENERGY_H */
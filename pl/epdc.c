@@ -26,8 +26,10 @@
 
 #include <pl/epdc.h>
 #include <pl/epdpsu.h>
+#include <pl/temp-sensor.h>
 #if PL_EPDC_STUB
 #include <pl/types.h>
+#include "pnm-utils.h"
 #endif
 #include <string.h>
 #include "assert.h"
@@ -60,13 +62,55 @@ int pl_epdc_get_wfid(struct pl_epdc *p, int wf_from)
 }
 #endif
 
+int pl_epdc_start_temp(struct pl_epdc *epdc)
+{
+	assert(epdc != NULL);
+
+	if ((epdc->temp_sensor == NULL) ||
+	    (epdc->temp_mode != PL_EPDC_TEMP_MANUAL))
+		return 0;
+
+	return pl_temp_sensor_start(epdc->temp_sensor);
+}
+
+int pl_epdc_update_temp(struct pl_epdc *epdc)
+{
+	int16_t temp;
+
+	assert(epdc != NULL);
+
+	if ((epdc->temp_sensor != NULL) &&
+	    (epdc->temp_mode == PL_EPDC_TEMP_MANUAL)) {
+		if (pl_temp_sensor_read(epdc->temp_sensor,
+					PL_EPDC_TEMP_MAX_AGE_MS, &temp))
+			LOG("Failed to read temperature, using %d",
+			    epdc->manual_temp);
+		else
+			epdc->manual_temp = temp;
+	}
+
+	return epdc->update_temp(epdc);
+}
+
+int pl_epdc_update_done(struct pl_epdc *epdc)
+{
+	assert(epdc != NULL);
+
+	if ((epdc->update_done != NULL) && !epdc->update_done(epdc))
+		return 0;
+
+	pl_epdc_queue_update_end(epdc);
+
+	return 1;
+}
+
 int pl_epdc_single_update(struct pl_epdc *epdc, struct pl_epdpsu *psu,
 			  int wfid, enum pl_update_mode mode, const struct pl_area *area)
 {
-	if (epdc->update_temp(epdc))
+	if (pl_epdc_update_temp(epdc))
 		return -1;
 
-	if (psu->on(psu))
+	if (pl_epdpsu_on(psu))
 		return -1;
 
 	if (epdc->update(epdc, wfid, mode, area))
@@ -75,7 +119,220 @@ int pl_epdc_single_update(struct pl_epdc *epdc, struct pl_epdpsu *psu,
 	if (epdc->wait_update_end(epdc))
 		return -1;
 
-	return psu->off(psu);
+	return pl_epdpsu_off(psu);
+}
+
+/* ----------------------------------------------------------------------------
+ * Update queue
+ */
+
+static const char * const queue_prio_names[PL_UPDATE_N_PRIO] = {
+	"low", "normal", "high",
+};
+
+static int area_covers(const struct pl_area *a, const struct pl_area *b)
+{
+	return ((a->left <= b->left) && (a->top <= b->top) &&
+		((a->left + a->width) >= (b->left + b->width)) &&
+		((a->top + a->height) >= (b->top + b->height)));
+}
+
+static int area_overlaps(const struct pl_area *a, const struct pl_area *b)
+{
+	return ((a->left < (b->left + b->width)) &&
+		(b->left < (a->left + a->width)) &&
+		(a->top < (b->top + b->height)) &&
+		(b->top < (a->top + a->height)));
+}
+
+static void area_merge(struct pl_area *a, const struct pl_area *b)
+{
+	const int right = max(a->left + a->width, b->left + b->width);
+	const int bottom = max(a->top + a->height, b->top + b->height);
+
+	a->left = min(a->left, b->left);
+	a->top = min(a->top, b->top);
+	a->width = right - a->left;
+	a->height = bottom - a->top;
+}
+
+static int is_full_mode(uint8_t mode)
+{
+	return ((mode == UPDATE_FULL) || (mode == UPDATE_FULL_AREA));
+}
+
+/* Check whether a higher priority update is running over the request area,
+ * which the new request would take over with the EPDC area priority */
+static int queue_is_held(const struct pl_update_queue *q,
+			 const struct pl_update_request *req)
+{
+	int prio;
+
+	for (prio = req->priority + 1; prio < PL_UPDATE_N_PRIO; ++prio)
+		if ((q->busy & (1 << prio)) &&
+		    area_overlaps(&req->area, &q->busy_area[prio]))
+			return 1;
+
+	return 0;
+}
+
+static int queue_send(struct pl_epdc *epdc)
+{
+	struct pl_update_queue *q = &epdc->queue;
+	struct pl_update_queue_stats *stats = &q->stats;
+	const struct pl_update_request req = q->req[0];
+	const uint32_t wait_us = pl_time_since(req.time_us);
+	const uint8_t mask = 1 << req.priority;
+
+	--q->n;
+	memmove(&q->req[0], &q->req[1], (q->n * sizeof(q->req[0])));
+
+	++stats->count[req.priority];
+	stats->wait_us[req.priority] += wait_us;
+
+	if (wait_us > stats->max_wait_us[req.priority])
+		stats->max_wait_us[req.priority] = wait_us;
+
+	if (q->busy & mask) {
+		area_merge(&q->busy_area[req.priority], &req.area);
+	} else {
+		q->busy_area[req.priority] = req.area;
+		q->busy |= mask;
+	}
+
+	return epdc->update(epdc, req.wfid, req.mode,
+			    req.full ? NULL : &req.area);
+}
+
+void pl_epdc_queue_reset(struct pl_epdc *epdc)
+{
+	assert(epdc != NULL);
+
+	memset(&epdc->queue, 0, sizeof(epdc->queue));
+}
+
+void pl_epdc_queue_update_end(struct pl_epdc *epdc)
+{
+	assert(epdc != NULL);
+
+	epdc->queue.busy = 0;
+}
+
+int pl_epdc_queue_update(struct pl_epdc *epdc, int wfid,
+			 enum pl_update_mode mode, const struct pl_area *area,
+			 enum pl_update_priority priority)
+{
+	struct pl_update_queue *q = &epdc->queue;
+	struct pl_update_request *req;
+	int i, j;
+
+	assert(epdc != NULL);
+	assert(priority < PL_UPDATE_N_PRIO);
+
+	for (i = 0, j = 0; i < q->n; ++i) {
+		const struct pl_update_request *it = &q->req[i];
+
+		if ((it->priority <= priority) &&
+		    (is_full_mode(mode) || !is_full_mode(it->mode)) &&
+		    ((area == NULL) || area_covers(area, &it->area))) {
+			++q->stats.superseded[it->priority];
+			continue;
+		}
+
+		if (i != j)
+			q->req[j] = *it;
+
+		++j;
+	}
+
+	q->n = j;
+
+	if (q->n == PL_EPDC_QUEUE_LEN) {
+		LOG("Update queue full");
+		return -1;
+	}
+
+	for (i = 0; i < q->n; ++i)
+		if (q->req[i].priority < priority)
+			break;
+
+	memmove(&q->req[i + 1], &q->req[i], ((q->n - i) * sizeof(q->req[0])));
+	++q->n;
+
+	req = &q->req[i];
+	req->time_us = pl_time_now_us();
+	req->wfid = wfid;
+	req->mode = mode;
+	req->priority = priority;
+	req->full = (area == NULL);
+
+	if (area == NULL) {
+		req->area.left = 0;
+		req->area.top = 0;
+		req->area.width = epdc->xres;
+		req->area.height = epdc->yres;
+	} else {
+		req->area = *area;
+	}
+
+	return 0;
+}
+
+int pl_epdc_queue_run(struct pl_epdc *epdc)
+{
+	struct pl_update_queue *q = &epdc->queue;
+
+	assert(epdc != NULL);
+
+	if (!q->n)
+		return 0;
+
+	if (epdc->area_priority && queue_is_held(q, &q->req[0])) {
+		if (!pl_epdc_update_done(epdc))
+			return 0;
+
+		if (epdc->wait_update_end(epdc))
+			return -1;
+	}
+
+	return queue_send(epdc) ? -1 : 1;
+}
+
+int pl_epdc_queue_flush(struct pl_epdc *epdc)
+{
+	struct pl_update_queue *q = &epdc->queue;
+
+	assert(epdc != NULL);
+
+	while (q->n) {
+		if (epdc->area_priority && queue_is_held(q, &q->req[0])) {
+			if (epdc->wait_update_end(epdc))
+				return -1;
+		}
+
+		if (queue_send(epdc))
+			return -1;
+	}
+
+	return 0;
+}
+
+void pl_epdc_queue_log(struct pl_epdc *epdc)
+{
+	const struct pl_update_queue_stats *stats = &epdc->queue.stats;
+	int i;
+
+	assert(epdc != NULL);
+
+	for (i = 0; i < PL_UPDATE_N_PRIO; ++i) {
+		if (!stats->count[i] && !stats->superseded[i])
+			continue;
+
+		LOG("queue %-6s %5u x, wait avg %lu us max %lu us, "
+		    "%u superseded", queue_prio_names[i], stats->count[i],
+		    stats->count[i] ? (stats->wait_us[i] / stats->count[i]) : 0,
+		    stats->max_wait_us[i], stats->superseded[i]);
+	}
 }
 
 #if PL_EPDC_STUB
@@ -135,6 +392,7 @@ static int stub_wait_update_end(struct pl_epdc *p)
 	STUB_LOG("wait_update_end");
 
 	mdelay(500);
+	pl_epdc_queue_update_end(p);
 
 	return 0;
 }
@@ -193,6 +451,17 @@ static int stub_load_image(struct pl_epdc *p, const char *path,
 	return 0;
 }
 
+static int stub_load_image_file(struct pl_epdc *p, struct pnm_file *img,
+				const struct pl_area *area, int left, int top)
+{
+#if STUB_VERBOSE
+	STUB_LOG("fill_image %dx%d, left=%d, top=%d",
+		 img->hdr.width, img->hdr.height, left, top);
+#endif
+
+	return 0;
+}
+
 int pl_epdc_stub_init(struct pl_epdc *p)
 {
 	STUB_LOG("stub init");
@@ -208,6 +477,7 @@ int pl_epdc_stub_init(struct pl_epdc *p)
 	p->update_temp = stub_update_temp;
 	p->fill = stub_fill;
 	p->load_image = stub_load_image;
+	p->load_image_file = stub_load_image_file;
 	p->wf_table = stub_wf_table;
 	p->xres = 640;
 	p->yres = 480;
@@ -29,6 +29,7 @@
 
 #include <stdint.h>
 #include <pl/wflib.h>
+#include <pl/types.h>
 
 /* Set to 1 to enable stub EPDC implementation */
 #define PL_EPDC_STUB 0
@@ -62,9 +63,50 @@ enum pl_update_mode {
 	UPDATE_PARTIAL_AREA = 3, //0x36,
 };
 
-struct pl_area;
+/** Update request priorities, higher ones are sent first */
+enum pl_update_priority {
+	PL_UPDATE_PRIO_LOW = 0,	/**< background refresh */
+	PL_UPDATE_PRIO_NORMAL,
+	PL_UPDATE_PRIO_HIGH,	/**< urgent user interface change */
+	PL_UPDATE_N_PRIO
+};
+
+/** Maximum number of update requests waiting in the queue */
+#define PL_EPDC_QUEUE_LEN 8
+
+/** Queued update request */
+struct pl_update_request {
+	struct pl_area area;	/**< whole display when full is set */
+	uint32_t time_us;	/**< pl_time_now_us() when queued */
+	int wfid;
+	uint8_t mode;		/**< enum pl_update_mode */
+	uint8_t priority;	/**< enum pl_update_priority */
+	uint8_t full;		/**< no area given to update() */
+};
+
+/** Update queue totals for each priority since the last reset */
+struct pl_update_queue_stats {
+	uint16_t count[PL_UPDATE_N_PRIO];	/**< requests sent */
+	uint16_t superseded[PL_UPDATE_N_PRIO];	/**< dropped, covered by a
+						 * later request */
+	uint32_t wait_us[PL_UPDATE_N_PRIO];	/**< total time queued */
+	uint32_t max_wait_us[PL_UPDATE_N_PRIO];	/**< longest time queued */
+};
+
+/** Host-side update queue */
+struct pl_update_queue {
+	struct pl_update_request req[PL_EPDC_QUEUE_LEN]; /**< by priority and
+							  * then in order */
+	uint8_t n;		/**< number of queued requests */
+	uint8_t busy;		/**< priorities sent since the last update end */
+	struct pl_area busy_area[PL_UPDATE_N_PRIO]; /**< and their bounds */
+	struct pl_update_queue_stats stats;
+};
+
 struct pl_dispinfo;
 struct pl_epdpsu;
+struct pl_temp_sensor;
+struct pnm_file;
 
 struct pl_wfid {
 	int id_from;
@@ -78,6 +120,7 @@ struct pl_epdc{
 	int (*load_wflib)(struct pl_epdc *p);
 	int (*update)(struct pl_epdc *p, int wfid, enum pl_update_mode mode, const struct pl_area *area);
 	int (*wait_update_end)(struct pl_epdc *p);
+	int (*update_done)(struct pl_epdc *p); /* optional */
 	int (*set_power)(struct pl_epdc *p, enum pl_epdc_power_state state);
 	int (*set_temp_mode)(struct pl_epdc *p, enum pl_epdc_temp_mode mode);
 	int (*update_temp)(struct pl_epdc *p);
@@ -85,6 +128,13 @@ struct pl_epdc{
 	int (*pattern_check)(struct pl_epdc *p, uint16_t size);
 	int (*load_image)(struct pl_epdc *p, const char *path,
 			  struct pl_area *area, int left, int top);
+	int (*load_image_file)(struct pl_epdc *p, struct pnm_file *img,
+			       struct pl_area *area, int left, int top);
+	/* optional, to stream 8bpp image data in chunks of an even length */
+	int (*load_image_begin)(struct pl_epdc *p, const struct pl_area *area);
+	int (*load_image_data)(struct pl_epdc *p, const uint8_t *data,
+			       size_t n);
+	int (*load_image_end)(struct pl_epdc *p);
 	int (*set_epd_power)(struct pl_epdc *p, int on);
 
 	const struct pl_wfid *wf_table;
@@ -93,8 +143,11 @@ struct pl_epdc{
 	enum pl_epdc_power_state power_state;
 	enum pl_epdc_temp_mode temp_mode;
 	int manual_temp;
+	struct pl_temp_sensor *temp_sensor; /* optional, for manual mode */
 	unsigned xres;
 	unsigned yres;
+	uint8_t area_priority; /* new area updates take overlapping pixels */
+	struct pl_update_queue queue;
 	void *data;
 };
 
@@ -118,6 +171,22 @@ extern const char wf_delta_mono[];    /**< delta/mono */
 /** Get a waveform identifier or -1 if not found */
 extern int pl_epdc_get_wfid(struct pl_epdc *p, int wf_from);
 
+/** Maximum age of a cached temperature sensor value used for an update */
+#define PL_EPDC_TEMP_MAX_AGE_MS 30000
+
+/** Start a temperature conversion with the temp_sensor if there is one, to
+ * be called ahead of the update so the result is ready when needed */
+extern int pl_epdc_start_temp(struct pl_epdc *epdc);
+
+/** Update the temperature, using the temp_sensor result in manual mode */
+extern int pl_epdc_update_temp(struct pl_epdc *epdc);
+
+/** Check whether the last update has ended without waiting, return 1 if it
+ * has or 0 if it is still running.  wait_update_end() still needs to be
+ * called afterwards, it then returns straight away.  Always 1 if the EPDC
+ * does not implement update_done(). */
+extern int pl_epdc_update_done(struct pl_epdc *epdc);
+
 /** Perform a typical single image update:
  * # Update temperature
  * # Turn the EPD PSU on
@@ -128,6 +197,54 @@ extern int pl_epdc_get_wfid(struct pl_epdc *p, int wf_from);
 extern int pl_epdc_single_update(struct pl_epdc *epdc, struct pl_epdpsu *psu,
 				 int wfid, enum pl_update_mode mode, const struct pl_area *area);
 
+/* --- Update queue --- */
+
+/** Empty the update queue and reset its totals */
+extern void pl_epdc_queue_reset(struct pl_epdc *epdc);
+
+/** Record the end of all the running updates, to be called by the EPDC
+ * implementation when wait_update_end() has succeeded.  This is also done by
+ * pl_epdc_update_done() when it returns 1. */
+extern void pl_epdc_queue_update_end(struct pl_epdc *epdc);
+
+/**
+   Queue an update request.  It is placed after the queued requests with the
+   same or a higher priority, so a high priority update goes ahead of the
+   low priority ones which have not been sent yet.  The queued requests of
+   the same or a lower priority fully covered by the new one are dropped,
+   unless this would turn a full update into a partial one.
+
+   The image data is only read by the EPDC once the request is sent, so the
+   queue needs to be flushed before loading new image data.
+
+   @param[in] epdc EPDC instance
+   @param[in] wfid waveform identifier, as for update()
+   @param[in] mode update mode, as for update()
+   @param[in] area area to update or NULL for the whole display
+   @param[in] priority enum pl_update_priority
+   @return 0 on success, -1 if the queue is full
+*/
+extern int pl_epdc_queue_update(struct pl_epdc *epdc, int wfid,
+				enum pl_update_mode mode,
+				const struct pl_area *area,
+				enum pl_update_priority priority);
+
+/** Send the next queued request without waiting.  When the EPDC gives new
+ * area updates priority over the running ones, a request overlapping a
+ * running update with a higher priority is held until that update has
+ * ended.  Return 1 if a request was sent, 0 if the queue is empty or the
+ * next request is being held, -1 on error.  From the event loop, call it
+ * until it returns 0 and again once pl_epdc_update_done() returns 1 if
+ * requests are still queued. */
+extern int pl_epdc_queue_run(struct pl_epdc *epdc);
+
+/** Send all the queued requests, waiting for the end of the running updates
+ * when a request is held */
+extern int pl_epdc_queue_flush(struct pl_epdc *epdc);
+
+/** Log the time spent in the queue for each priority */
+extern void pl_epdc_queue_log(struct pl_epdc *epdc);
+
 #if PL_EPDC_STUB
 /** Initialise a stub implementation for debugging purposes */
 extern int pl_epdc_stub_init(struct pl_epdc *p);
@@ -27,7 +27,9 @@
 #include <pl/epdpsu.h>
 #include <pl/gpio.h>
 #include <pl/epdc.h>
+#include <pl/energy.h>
 #include "assert.h"
+#include "trace.h"
 
 #define LOG_TAG "epdpsu"
 #include "utils.h"
@@ -35,12 +37,201 @@
 /* Set to 1 to enable verbose logging */
 #define LOG_VERBOSE 0
 
+/* --- Keep-alive --- */
+
+int pl_epdpsu_on(struct pl_epdpsu *psu)
+{
+	int stat;
+
+	assert(psu != NULL);
+
+	psu->off_pending = 0;
+
+	if (psu->state)
+		return 0;
+
+	trace_begin(TRACE_PSU_ON, 0);
+	pl_energy_begin(PL_ENERGY_PSU_ON);
+	stat = psu->on(psu);
+	pl_energy_end(PL_ENERGY_PSU_ON);
+	trace_end(TRACE_PSU_ON, 0);
+
+	if (psu->state)
+		pl_energy_begin(PL_ENERGY_HV_ON);
+
+	return stat;
+}
+
+static int pl_epdpsu_do_off(struct pl_epdpsu *psu)
+{
+	int stat = psu->off(psu);
+
+	if (!psu->state)
+		pl_energy_end(PL_ENERGY_HV_ON);
+
+	return stat;
+}
+
+int pl_epdpsu_off(struct pl_epdpsu *psu)
+{
+	assert(psu != NULL);
+
+	if (!psu->keep_alive_ms)
+		return pl_epdpsu_do_off(psu);
+
+	if (psu->state) {
+		psu->off_pending = 1;
+		psu->off_time = time_ticks();
+	}
+
+	return 0;
+}
+
+int pl_epdpsu_poll(struct pl_epdpsu *psu)
+{
+	uint32_t keep_alive;
+
+	assert(psu != NULL);
+
+	if (!psu->off_pending)
+		return 0;
+
+	keep_alive = ((uint32_t)psu->keep_alive_ms * TIME_TICKS_PER_SECOND) /
+		1000;
+
+	if ((time_ticks() - psu->off_time) < keep_alive)
+		return 0;
+
+	return pl_epdpsu_flush(psu);
+}
+
+int pl_epdpsu_flush(struct pl_epdpsu *psu)
+{
+	assert(psu != NULL);
+
+	if (!psu->off_pending)
+		return 0;
+
+#if LOG_VERBOSE
+	LOG("keep-alive expired");
+#endif
+
+	psu->off_pending = 0;
+
+	return pl_epdpsu_do_off(psu);
+}
+
+/* --- Calibration --- */
+
+/* Number of measurement cycles, the longest time is used */
+#define CAL_CYCLES 3
+
+/* Number of consecutive identical readings for the rails to be stable */
+#define CAL_STABLE_READS 3
+
+/* Maximum time to wait for the rails to settle */
+#define CAL_TIMEOUT_MS 1000
+
+/* Safety margin added to the measured times: 50% plus 2 ms */
+#define CAL_MARGIN(_ms) ((_ms) + ((_ms) / 2) + 2)
+
+/* start is when the power on or off command was issued, as the PSU may only
+ * return once it reports power OK */
+static int cal_wait_rails(struct pl_epdpsu *psu, int state, uint32_t start,
+			  unsigned *ms)
+{
+	uint32_t settled = start;
+	unsigned timeout;
+	int stable = 0;
+
+	for (timeout = CAL_TIMEOUT_MS; timeout; --timeout) {
+		const int rails = psu->get_rails(psu);
+
+		if (rails < 0)
+			return -1;
+
+		if (rails != state) {
+			stable = 0;
+		} else if (!stable++) {
+			settled = time_ticks();
+		} else if (stable == CAL_STABLE_READS) {
+			*ms = ((settled - start) * 1000) /
+				TIME_TICKS_PER_SECOND;
+			return 0;
+		}
+
+		mdelay(1);
+	}
+
+	LOG("Rails did not settle");
+
+	return -1;
+}
+
+int pl_epdpsu_calibrate(struct pl_epdpsu *psu, unsigned *on_delay_ms,
+			unsigned *off_delay_ms)
+{
+	unsigned on_ms = 0, off_ms = 0;
+	int i;
+
+	assert(psu != NULL);
+	assert(on_delay_ms != NULL);
+	assert(off_delay_ms != NULL);
+
+	if ((psu->get_rails == NULL) || psu->state)
+		return -1;
+
+	for (i = 0; i < CAL_CYCLES; ++i) {
+		uint32_t start;
+		unsigned ms;
+
+		start = time_ticks();
+
+		if (psu->on(psu))
+			return -1;
+
+		if (cal_wait_rails(psu, PL_EPDPSU_RAILS_GOOD, start, &ms))
+			goto error_off;
+
+		if (ms > on_ms)
+			on_ms = ms;
+
+		start = time_ticks();
+
+		if (psu->off(psu))
+			return -1;
+
+		if (cal_wait_rails(psu, PL_EPDPSU_RAILS_OFF, start, &ms))
+			return -1;
+
+		if (ms > off_ms)
+			off_ms = ms;
+	}
+
+	/* get_rails may only see the regulators, so never go below the
+	 * default delays which also cover the outputs discharging */
+	if (CAL_MARGIN(on_ms) > *on_delay_ms)
+		*on_delay_ms = CAL_MARGIN(on_ms);
+
+	if (CAL_MARGIN(off_ms) > *off_delay_ms)
+		*off_delay_ms = CAL_MARGIN(off_ms);
+
+	LOG("Calibrated delays: on %u ms (measured %u), off %u ms (measured %u)",
+	    *on_delay_ms, on_ms, *off_delay_ms, off_ms);
+
+	return 0;
+
+error_off:
+	psu->off(psu);
+
+	return -1;
+}
+
 /* --- GPIO --- */
 
 static int pl_epdpsu_gpio_on(struct pl_epdpsu *psu)
 {
 	struct pl_epdpsu_gpio *p = psu->data;
-	unsigned timeout;
 
 	if (psu->state)
 		return 0;
@@ -51,13 +242,7 @@ static int pl_epdpsu_gpio_on(struct pl_epdpsu *psu)
 
 	pl_gpio_set(p->gpio, p->hv_en, 1);
 
-	for (timeout = p->timeout_ms; timeout; timeout--) {
-		if (pl_gpio_get(p->gpio, p->pok))
-			break;
-		mdelay(1);
-	}
-
-	if (!timeout) {
+	if (pl_gpio_wait(p->gpio, p->pok, 1, p->timeout_ms)) {
 		LOG("POK timeout");
 		pl_gpio_set(p->gpio, p->hv_en, 0);
 		return -1;
@@ -100,6 +285,8 @@ int pl_epdpsu_gpio_init(struct pl_epdpsu *psu, struct pl_epdpsu_gpio *p)
 	psu->on = pl_epdpsu_gpio_on;
 	psu->off = pl_epdpsu_gpio_off;
 	psu->state = 0;
+	psu->keep_alive_ms = 0;
+	psu->off_pending = 0;
 	psu->data = p;
 
 	return 0;
@@ -140,6 +327,8 @@ int pl_epdpsu_epdc_init(struct pl_epdpsu *psu, struct pl_epdc *epdc)
 	psu->on = pl_epdpsu_epdc_on;
 	psu->off = pl_epdpsu_epdc_off;
 	psu->state = 0;
+	psu->keep_alive_ms = 0;
+	psu->off_pending = 0;
 	psu->data = epdc;
 
 	return 0;
@@ -151,6 +340,8 @@ int pl_epdpsu_i2c_init(struct pl_epdpsu *psu, struct pl_epdpsu_i2c *psu_i2c)
 	psu->on = NULL; // to be set by implementation
 	psu->off = NULL; // to be set by implementation
 	psu->state = 0;
+	psu->keep_alive_ms = 0;
+	psu->off_pending = 0;
 	psu->data = psu_i2c;
 
 	return 0;
@@ -189,6 +380,8 @@ int pl_epdpsu_stub_init(struct pl_epdpsu *psu)
 	psu->on = pl_epdpsu_stub_on;
 	psu->off = pl_epdpsu_stub_off;
 	psu->state = 0;
+	psu->keep_alive_ms = 0;
+	psu->off_pending = 0;
 	psu->data = NULL;
 
 	return 0;
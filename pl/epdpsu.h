@@ -33,11 +33,20 @@
    Abstract interface and generic implementation to the EPD PSU
 */
 
+#include <stdint.h>
+
 /** Set to 1 to enable stub  */
 #define PL_EPDPSU_STUB 0
 
 struct pl_epdc;
 
+/** Power good status of the rails, see get_rails */
+enum pl_epdpsu_rails {
+	PL_EPDPSU_RAILS_OFF = 0,	/**< no rail is in regulation */
+	PL_EPDPSU_RAILS_GOOD = 1,	/**< all the rails are in regulation */
+	PL_EPDPSU_RAILS_PARTIAL = 2,	/**< some of the rails are */
+};
+
 /** Interface */
 struct pl_epdpsu {
 	/**
@@ -56,8 +65,58 @@ struct pl_epdpsu {
 
 	int state;            /**< current power state (1=on, 0=off) */
 	void *data;           /**< private data for the implementation */
+
+	/**
+	   read the power good status of the rails from the HV-PMIC, optional
+	   @param[in] psu pl_epdpsu instance
+	   @return PL_EPDPSU_RAILS_xxx or -1 if an error occured
+	 */
+	int (*get_rails)(struct pl_epdpsu *psu);
+
+	void *pmic;           /**< HV-PMIC private data for get_rails */
+
+	unsigned keep_alive_ms; /**< time to keep the power on after
+				   pl_epdpsu_off, 0 to turn it off at once */
+	int off_pending;      /**< set when the power is kept on */
+	uint32_t off_time;    /**< time_ticks() when the power was released */
 };
 
+/**
+   Turn the EPD PSU on, or cancel a pending power off.
+
+   @param[in] psu pl_epdpsu instance
+   @return -1 if an error occured, 0 otherwise
+*/
+extern int pl_epdpsu_on(struct pl_epdpsu *psu);
+
+/**
+   Release the EPD PSU, it is turned off straight away if keep_alive_ms is 0
+   or after keep_alive_ms otherwise, so consecutive updates do not have to
+   wait for the power to go down and up again.
+
+   @param[in] psu pl_epdpsu instance
+   @return -1 if an error occured, 0 otherwise
+*/
+extern int pl_epdpsu_off(struct pl_epdpsu *psu);
+
+/**
+   Turn the EPD PSU off if it has been released for more than keep_alive_ms,
+   to be called regularly.
+
+   @param[in] psu pl_epdpsu instance
+   @return -1 if an error occured, 0 otherwise
+*/
+extern int pl_epdpsu_poll(struct pl_epdpsu *psu);
+
+/**
+   Turn the EPD PSU off now if it has been released, i.e. before sleeping for
+   a long time.
+
+   @param[in] psu pl_epdpsu instance
+   @return -1 if an error occured, 0 otherwise
+*/
+extern int pl_epdpsu_flush(struct pl_epdpsu *psu);
+
 /** Generic GPIO-based implementation */
 struct pl_epdpsu_gpio {
 	struct pl_gpio *gpio; /**< pl_gpio instance to control the GPIOs */
@@ -75,6 +134,8 @@ struct pl_epdpsu_i2c {
 	struct pl_gpio *gpio; /**< pl_gpio instance to control the GPIOs */
 	struct pl_i2c *i2c;
 	unsigned com_close;   /**< GPIO number to close the COM switch */
+	unsigned pok;         /**< GPIO number to read Power OK, or
+				 PL_GPIO_NONE to poll the PMIC over I2C */
 	unsigned timeout_ms;  /**< Maximum time in ms to wait for POK */
 	unsigned on_delay_ms; /**< Delay after turning the power on */
 	unsigned off_delay_ms;/**< Delay after turning the power off */
@@ -104,6 +165,24 @@ extern int pl_epdpsu_epdc_init(struct pl_epdpsu *psu, struct pl_epdc *epdc);
 
 int pl_epdpsu_i2c_init(struct pl_epdpsu *psu, struct pl_epdpsu_i2c *psu_i2c);
 
+/**
+   Measure how long the rails take to settle after the power on command, and
+   to go down after the power off command, using get_rails.  The PSU
+   implementation must not add any delay of its own while this is running.
+
+   The delays are only increased, as get_rails may not tell when the outputs
+   have discharged, so the default ones are kept as the minimum.
+
+   @param[in] psu pl_epdpsu instance, turned off
+   @param[in,out] on_delay_ms default delay after turning the power on,
+                  replaced with the calibrated one
+   @param[in,out] off_delay_ms default delay after turning the power off,
+                  replaced with the calibrated one
+   @return -1 if an error occured, 0 otherwise
+*/
+extern int pl_epdpsu_calibrate(struct pl_epdpsu *psu, unsigned *on_delay_ms,
+			       unsigned *off_delay_ms);
+
 #if PL_EPDPSU_STUB
 /** Initialise an pl_epdpsu instance with stub implementation.
 
@@ -49,6 +49,27 @@ int pl_gpio_config_list(struct pl_gpio *gpio,
 	return 0;
 }
 
+int pl_gpio_wait(struct pl_gpio *gpio, unsigned n, int value,
+		 unsigned timeout_ms)
+{
+	assert(gpio != NULL);
+
+	if (gpio->wait != NULL)
+		return gpio->wait(n, value, timeout_ms);
+
+	value = !!value;
+
+	for (;;) {
+		if (!!pl_gpio_get(gpio, n) == value)
+			return 0;
+
+		if (!timeout_ms--)
+			return -1;
+
+		msleep(1);
+	}
+}
+
 #if PL_GPIO_DEBUG
 void pl_gpio_log_flags(uint16_t flags)
 {
@@ -92,6 +92,15 @@ struct pl_gpio {
 	    @param[in] value value to set the GPIO state
 	 */
 	void (*set)(unsigned gpio, int value);
+
+	/** Wait for a GPIO to reach a given state, typically using an
+	    interrupt; optional, see pl_gpio_wait
+	    @param[in] gpio GPIO number
+	    @param[in] value state to wait for
+	    @param[in] timeout_ms maximum time to wait in milliseconds
+	    @return -1 if timeout, 0 otherwise
+	 */
+	int (*wait)(unsigned gpio, int value, unsigned timeout_ms);
 };
 
 /** GPIO configuration information */
@@ -109,6 +118,17 @@ struct pl_gpio_config {
 extern int pl_gpio_config_list(struct pl_gpio *gpio,
 			       const struct pl_gpio_config *config, size_t n);
 
+/** Wait for a GPIO to reach a given state, polling it every millisecond if
+    the implementation does not provide a wait function
+    @param[in] gpio gpio instance
+    @param[in] n GPIO number
+    @param[in] value state to wait for
+    @param[in] timeout_ms maximum time to wait in milliseconds
+    @return -1 if timeout, 0 otherwise
+*/
+extern int pl_gpio_wait(struct pl_gpio *gpio, unsigned n, int value,
+			unsigned timeout_ms);
+
 #if PL_GPIO_DEBUG
 /** Log a human-readable version of the flags
     @param[in] flags flags bitmask
@@ -27,6 +27,7 @@
 
 #include <pl/i2c.h>
 #include <pl/endian.h>
+#include <stdlib.h>
 
 int pl_i2c_reg_read_8(struct pl_i2c *i2c, uint8_t i2c_addr, uint8_t reg,
 		      uint8_t *data)
@@ -69,3 +70,31 @@ int pl_i2c_reg_write_16be(struct pl_i2c *i2c, uint8_t i2c_addr, uint8_t reg,
 
 	return i2c->write(i2c, i2c_addr, w_data, sizeof(w_data), 0);
 }
+
+int pl_i2c_reg_read_n(struct pl_i2c *i2c, uint8_t i2c_addr, uint8_t reg,
+		      uint8_t *data, uint8_t count)
+{
+	if (i2c->write(i2c, i2c_addr, &reg, 1, PL_I2C_NO_STOP))
+		return -1;
+
+	return i2c->read(i2c, i2c_addr, data, count, 0);
+}
+
+int pl_i2c_reg_write_n(struct pl_i2c *i2c, uint8_t i2c_addr, uint8_t reg,
+		       const uint8_t *data, uint8_t count)
+{
+	if (i2c->write(i2c, i2c_addr, &reg, 1, PL_I2C_NO_STOP))
+		return -1;
+
+	return i2c->write(i2c, i2c_addr, data, count, PL_I2C_NO_START);
+}
+
+int pl_i2c_set_speed(struct pl_i2c *i2c, unsigned khz)
+{
+	if ((i2c->set_speed == NULL) || i2c->set_speed(i2c, khz))
+		return -1;
+
+	i2c->khz = khz;
+
+	return 0;
+}
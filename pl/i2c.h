@@ -68,6 +68,14 @@ struct pl_i2c {
 	int (*write)(struct pl_i2c *i2c, uint8_t addr,
 		     const uint8_t *data, uint8_t count, uint8_t flags);
 
+	/**
+	   change the SCL frequency, called with the bus idle
+	   @param[in] i2c this pl_i2c instance
+	   @param[in] khz SCL frequency in kHz
+	   @return -1 if not supported, 0 otherwise
+	 */
+	int (*set_speed)(struct pl_i2c *i2c, unsigned khz);
+
 	/**
 	   free the resources associated with this instance
 	   @param i2c this pl_i2c instance
@@ -78,6 +86,11 @@ struct pl_i2c {
 	   private data specific to this instance
 	 */
 	void *priv;
+
+	/**
+	   current SCL frequency in kHz
+	 */
+	uint16_t khz;
 };
 
 /** Read an 8-bit register on the I2C bus
@@ -120,4 +133,35 @@ extern int pl_i2c_reg_read_16be(struct pl_i2c *i2c, uint8_t addr,
 extern int pl_i2c_reg_write_16be(struct pl_i2c *i2c, uint8_t addr,
 				 uint8_t reg, uint16_t data);
 
+/** Read consecutive 8-bit registers in one transfer, for devices which
+    auto-increment the register address
+    @param[in] i2c pl_i2c instance
+    @param[in] addr I2C address
+    @param[in] reg first register address
+    @param[out] data buffer to store the register values
+    @param[in] count number of registers to read
+    @return -1 if error, 0 otherwise
+ */
+extern int pl_i2c_reg_read_n(struct pl_i2c *i2c, uint8_t addr, uint8_t reg,
+			     uint8_t *data, uint8_t count);
+
+/** Write consecutive 8-bit registers in one transfer, for devices which
+    auto-increment the register address
+    @param[in] i2c pl_i2c instance
+    @param[in] addr I2C address
+    @param[in] reg first register address
+    @param[in] data register values
+    @param[in] count number of registers to write
+    @return -1 if error, 0 otherwise
+ */
+extern int pl_i2c_reg_write_n(struct pl_i2c *i2c, uint8_t addr, uint8_t reg,
+			      const uint8_t *data, uint8_t count);
+
+/** Change the SCL frequency
+    @param[in] i2c pl_i2c instance
+    @param[in] khz SCL frequency in kHz, typically 100, 400 or 1000
+    @return -1 if not supported by the bus master, 0 otherwise
+ */
+extern int pl_i2c_set_speed(struct pl_i2c *i2c, unsigned khz);
+
 #endif /* INCLUDE_PL_I2C_H */
@@ -43,6 +43,10 @@ struct pl_interface
   int (*read)(uint8_t *buff, uint8_t size);
   int (*write)(uint8_t *buff, uint8_t size);
   int (*set_cs)(uint8_t cs);
+  /* Optional, start a DMA write of up to 64KB and return immediately */
+  int (*dma_write)(const uint8_t *buff, uint16_t size);
+  /* Optional, wait for the DMA write started with dma_write to complete */
+  int (*dma_wait)(void);
 
   struct spi_metadata *mSpi;
 };
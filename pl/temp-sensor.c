@@ -0,0 +1,127 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * temp-sensor.c -- Temperature sensor interface with cached result
+ *
+ */
+
+#include <pl/temp-sensor.h>
+#include "assert.h"
+
+#define LOG_TAG "temp-sensor"
+#include "utils.h"
+
+/* Maximum time to wait for a conversion to complete */
+#define CONVERSION_TIMEOUT_MS 100
+
+int pl_temp_sensor_start(struct pl_temp_sensor *s)
+{
+	assert(s != NULL);
+
+	if (s->busy)
+		return 0;
+
+	if (s->start(s))
+		return -1;
+
+	s->busy = 1;
+
+	return 0;
+}
+
+int pl_temp_sensor_poll(struct pl_temp_sensor *s)
+{
+	int16_t temp;
+	int stat;
+
+	assert(s != NULL);
+
+	if (!s->busy)
+		return 0;
+
+	stat = s->collect(s, &temp);
+
+	if (stat == 1)
+		return 1;
+
+	s->busy = 0;
+
+	if (stat)
+		return -1;
+
+	s->temp = temp;
+	s->time = time_ticks();
+	s->valid = 1;
+
+	return 0;
+}
+
+int pl_temp_sensor_read(struct pl_temp_sensor *s, unsigned max_age_ms,
+			int16_t *temp)
+{
+	unsigned timeout;
+	int stat;
+
+	assert(s != NULL);
+	assert(temp != NULL);
+
+	if (s->valid && !s->busy && (pl_temp_sensor_age(s) <= max_age_ms)) {
+		*temp = s->temp;
+		return 0;
+	}
+
+	if (pl_temp_sensor_start(s))
+		return -1;
+
+	for (timeout = CONVERSION_TIMEOUT_MS; timeout; --timeout) {
+		stat = pl_temp_sensor_poll(s);
+
+		if (stat < 0)
+			return -1;
+
+		if (!stat) {
+			*temp = s->temp;
+			return 0;
+		}
+
+		msleep(1);
+	}
+
+	LOG("Conversion timeout");
+	s->busy = 0;
+
+	return -1;
+}
+
+unsigned pl_temp_sensor_age(const struct pl_temp_sensor *s)
+{
+	uint32_t age;
+
+	assert(s != NULL);
+
+	if (!s->valid)
+		return (unsigned)-1;
+
+	age = time_ticks() - s->time;
+
+	if (age >= ((0xFFFEUL * TIME_TICKS_PER_SECOND) / 1000))
+		return 0xFFFE;
+
+	return (age * 1000) / TIME_TICKS_PER_SECOND;
+}
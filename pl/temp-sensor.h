@@ -0,0 +1,98 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * temp-sensor.h -- Temperature sensor interface with cached result
+ *
+ */
+
+#ifndef INCLUDE_PL_TEMP_SENSOR_H
+#define INCLUDE_PL_TEMP_SENSOR_H 1
+
+#include <stdint.h>
+
+/**
+   @file pl/temp-sensor.h
+
+   Temperature sensors with a split start/collect interface so a conversion
+   can run while doing something else, and a cached result with its age.
+*/
+
+/** Interface */
+struct pl_temp_sensor {
+	/**
+	   start a conversion
+	   @param[in] s pl_temp_sensor instance
+	   @return -1 if an error occured, 0 otherwise
+	 */
+	int (*start)(struct pl_temp_sensor *s);
+
+	/**
+	   collect the result of the conversion if it is complete
+	   @param[in] s pl_temp_sensor instance
+	   @param[out] temp temperature in degrees Celsius
+	   @return 0 if done, 1 if still in progress, -1 if an error occured
+	 */
+	int (*collect)(struct pl_temp_sensor *s, int16_t *temp);
+
+	void *data;           /**< private data for the implementation */
+
+	int16_t temp;         /**< last measured temperature */
+	uint32_t time;        /**< time_ticks() of the last measurement */
+	uint8_t valid;        /**< set when temp holds a measurement */
+	uint8_t busy;         /**< set while a conversion is in progress */
+};
+
+/**
+   Start a conversion unless one is already in progress.
+
+   @param[in] s pl_temp_sensor instance
+   @return -1 if an error occured, 0 otherwise
+*/
+extern int pl_temp_sensor_start(struct pl_temp_sensor *s);
+
+/**
+   Update the cached value if the conversion in progress is complete, without
+   waiting.
+
+   @param[in] s pl_temp_sensor instance
+   @return 0 if idle, 1 if still in progress, -1 if an error occured
+*/
+extern int pl_temp_sensor_poll(struct pl_temp_sensor *s);
+
+/**
+   Get the temperature, from the cache if it is not older than max_age_ms or
+   otherwise by completing the conversion in progress or starting a new one.
+
+   @param[in] s pl_temp_sensor instance
+   @param[in] max_age_ms maximum age of the cached value
+   @param[out] temp temperature in degrees Celsius
+   @return -1 if an error occured, 0 otherwise
+*/
+extern int pl_temp_sensor_read(struct pl_temp_sensor *s, unsigned max_age_ms,
+			       int16_t *temp);
+
+/**
+   Get the age of the cached value.
+
+   @param[in] s pl_temp_sensor instance
+   @return age in milliseconds, or (unsigned)-1 if there is no valid value
+*/
+extern unsigned pl_temp_sensor_age(const struct pl_temp_sensor *s);
+
+#endif /* INCLUDE_PL_TEMP_SENSOR_H */
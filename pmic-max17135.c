@@ -24,6 +24,8 @@
  */
 
 #include <pl/i2c.h>
+#include <pl/epdpsu.h>
+#include <pl/temp-sensor.h>
 #include <stddef.h>
 #include "assert.h"
 #include "vcom.h"
@@ -37,6 +39,9 @@
 #define	HVPMIC_TEMP_INVALID	0x7FC0
 #define	HVPMIC_TEMP_DEFAULT	20
 
+/* maximum time to wait for a conversion in max17135_temperature_measure */
+#define HVPMIC_TEMP_TIMEOUT_MS	10
+
 #define	HVPMIC_DAC_MAX		((1 << 8)-1)
 #define	HVPMIC_DAC_MIN		0
 
@@ -283,7 +288,7 @@ int max17135_wait_pok(struct max17135_info *pmic)
 	while (!pok) {
 		union max17135_fault fault;
 
-		mdelay(POLL_DELAY_MS);
+		msleep(POLL_DELAY_MS);
 
 		if (pl_i2c_reg_read_8(pmic->i2c, pmic->i2c_addr,
 				      HVPMIC_REG_FAULT, &fault.byte)) {
@@ -308,6 +313,21 @@ int max17135_wait_pok(struct max17135_info *pmic)
 	return 0;
 }
 
+/* The FAULT register only has the overall power OK status */
+int max17135_get_rails(struct pl_epdpsu *psu)
+{
+	struct max17135_info *pmic = psu->pmic;
+	union max17135_fault fault;
+
+	assert(pmic != NULL);
+
+	if (pl_i2c_reg_read_8(pmic->i2c, pmic->i2c_addr, HVPMIC_REG_FAULT,
+			      &fault.byte))
+		return -1;
+
+	return fault.pok ? PL_EPDPSU_RAILS_GOOD : PL_EPDPSU_RAILS_OFF;
+}
+
 /* use the i2c interface to power up the PMIC */
 int max17135_enable(struct max17135_info *pmic)
 {
@@ -344,20 +364,28 @@ int max17135_temp_disable(struct max17135_info *pmic)
 				  config.byte);
 }
 
-/* read the temperature from the PMIC */
-int max17135_temperature_measure(struct max17135_info *pmic, int16_t *measured)
+/* the sensor converts continuously, so there is nothing to trigger */
+static int max17135_temp_start(struct pl_temp_sensor *s)
 {
+	return 0;
+}
+
+static int max17135_temp_collect(struct pl_temp_sensor *s, int16_t *measured)
+{
+	struct max17135_info *pmic = s->data;
 	union max17135_temp_status status;
 	union max17135_temp_value temp;
-	int stat;
 
 	if (pl_i2c_reg_read_8(pmic->i2c, pmic->i2c_addr, HVPMIC_REG_TEMP_STAT,
 			      &status.byte))
-		goto error;
+		return -1;
+
+	if (status.byte & HVPMIC_TEMP_BUSY)
+		return 1;
 
 	if (pl_i2c_reg_read_16be(pmic->i2c, pmic->i2c_addr, HVPMIC_REG_EXT_TEMP,
 				 &temp.word))
-		goto error;
+		return -1;
 
 	if (status.byte & (HVPMIC_TEMP_OPEN | HVPMIC_TEMP_SHORT)) {
 		LOG("Temperature sensor error: 0x%02x", status.byte);
@@ -365,14 +393,48 @@ int max17135_temperature_measure(struct max17135_info *pmic, int16_t *measured)
 
 	if (temp.word == HVPMIC_TEMP_INVALID) {
 		*measured = HVPMIC_TEMP_DEFAULT;
-		stat = -1;
-	} else {
-		*measured = (temp.measured >> 1);
-		stat = 0;
+		return -1;
 	}
 
+	*measured = (temp.measured >> 1);
+
 	LOG("Temperature: %d", *measured);
 
-error:
-	return stat;
+	return 0;
+}
+
+void max17135_temp_sensor_init(struct pl_temp_sensor *s,
+			       struct max17135_info *pmic)
+{
+	assert(s != NULL);
+	assert(pmic != NULL);
+
+	s->start = max17135_temp_start;
+	s->collect = max17135_temp_collect;
+	s->data = pmic;
+	s->valid = 0;
+	s->busy = 0;
+}
+
+/* read the temperature from the PMIC */
+int max17135_temperature_measure(struct max17135_info *pmic, int16_t *measured)
+{
+	struct pl_temp_sensor s;
+	unsigned timeout;
+	int stat;
+
+	max17135_temp_sensor_init(&s, pmic);
+
+	for (timeout = HVPMIC_TEMP_TIMEOUT_MS; timeout; --timeout) {
+		stat = max17135_temp_collect(&s, measured);
+
+		if (stat != 1)
+			return stat;
+
+		msleep(1);
+	}
+
+	LOG("Temperature conversion timeout");
+
+	return -1;
 }
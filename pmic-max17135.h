@@ -31,6 +31,8 @@
 #include <stdint.h>
 
 struct max17135_info;
+struct pl_epdpsu;
+struct pl_temp_sensor;
 
 enum {
 	MAX17135_SEQ_0,	// Type4, Maxim Driver timing
@@ -46,11 +48,14 @@ extern int max17135_set_vcom_register(struct max17135_info *pmic,
 				      int dac_value);
 
 extern int max17135_wait_pok(struct max17135_info *pmic);
+extern int max17135_get_rails(struct pl_epdpsu *psu);
 extern int max17135_enable(struct max17135_info *pmic);
 extern int max17135_disable(struct max17135_info *pmic);
 
 extern int max17135_temp_enable(struct max17135_info *pmic);
 extern int max17135_temp_disable(struct max17135_info *pmic);
+extern void max17135_temp_sensor_init(struct pl_temp_sensor *s,
+				      struct max17135_info *pmic);
 extern int max17135_temperature_measure(struct max17135_info *pmic,
 					int16_t *measured);
 
@@ -29,6 +29,7 @@
 #include <pl/epdpsu.h>
 #include <stdlib.h>
 #include <pl/gpio.h>
+#include <pl/temp-sensor.h>
 #include "assert.h"
 #include "vcom.h"
 #include "pmic-tps65185.h"
@@ -47,6 +48,9 @@
 #define HVPMIC_TEMP_DEFAULT     20
 #define HVPMIC_VERSION          0x65
 
+/* Interval between PG status reads when there is no POK GPIO */
+#define TPS65185_POK_POLL_MS    5
+
 #if 0
 #define MV_DIV	33		// Each DAC step is 33mV
 #endif
@@ -81,26 +85,51 @@ union tps65185_version {
 	uint8_t byte;
 };
 
-struct pmic_data {
-	uint8_t reg;
-	uint8_t data;
+/* Contiguous register ranges written with auto-increment, INT1 and INT2 are
+ * read-only so they split the initial configuration in two */
+#define INIT_BLOCK_MAX 6
+
+struct pmic_block {
+	uint8_t reg;                    /* first register */
+	uint8_t count;
+	uint8_t data[INIT_BLOCK_MAX];
+	uint8_t mask[INIT_BLOCK_MAX];   /* bits checked when reading back */
 };
 
-static const struct pmic_data init_data[] = {
-	{ HVPMIC_REG_ENABLE,     0x00 },
-	{ HVPMIC_REG_VADJ,       0x03 },
-	{ HVPMIC_REG_VCOM1,      0x00 },
-	{ HVPMIC_REG_VCOM2,      0x00 },
-	{ HVPMIC_REG_INT_EN1,    0x00 },
-	{ HVPMIC_REG_INT_EN2,    0x00 },
-	{ HVPMIC_REG_UPSEQ0,     0x78 },
-	{ HVPMIC_REG_UPSEQ1,     0x00 },
-	{ HVPMIC_REG_DWNSEQ0,    0x00 },
-	{ HVPMIC_REG_DWNSEQ1,    0x00 },
-	{ HVPMIC_REG_TMST1,      0x00 },
-	{ HVPMIC_REG_TMST2,      0x78 }
+static const struct pmic_block init_data[] = {
+	{ HVPMIC_REG_ENABLE, 6,
+	  /* ENABLE, VADJ, VCOM1, VCOM2, INT_EN1, INT_EN2 */
+	  { 0x00, 0x03, 0x00, 0x00, 0x00, 0x00 },
+	  { 0x3F, 0x07, 0xFF, 0x3F, 0xFF, 0xFF } },
+	{ HVPMIC_REG_UPSEQ0, 6,
+	  /* UPSEQ0, UPSEQ1, DWNSEQ0, DWNSEQ1, TMST1, TMST2 */
+	  { 0x78, 0x00, 0x00, 0x00, 0x00, 0x78 },
+	  { 0xFF, 0xFF, 0xFF, 0xFF, 0x1F, 0xFF } },
 };
 
+static int write_block(struct pl_i2c *i2c, uint8_t i2c_addr,
+		       const struct pmic_block *b)
+{
+	uint8_t data[INIT_BLOCK_MAX];
+	int i;
+
+	if (pl_i2c_reg_write_n(i2c, i2c_addr, b->reg, b->data, b->count))
+		return -1;
+
+	if (pl_i2c_reg_read_n(i2c, i2c_addr, b->reg, data, b->count))
+		return -1;
+
+	for (i = 0; i < b->count; ++i) {
+		if ((data[i] ^ b->data[i]) & b->mask[i]) {
+			LOG("Failed to write reg[0x%02X]: 0x%02X instead of "
+			    "0x%02X", (b->reg + i), data[i], b->data[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 #if DO_REG_DUMP
 /* Note: reading some registers will modify the status of the device */
 static void reg_dump(struct tps65185_info *p)
@@ -137,8 +166,7 @@ int tps65185_init(struct pl_epdpsu *psu, struct tps65185_info *p, struct pl_i2c
 	}
 
 	for (i = 0; i < ARRAY_SIZE(init_data); i++) {
-		if (pl_i2c_reg_write_8(i2c, i2c_addr, init_data[i].reg,
-				       init_data[i].data))
+		if (write_block(i2c, i2c_addr, &init_data[i]))
 			return -1;
 	}
 	// find out on which setting we are: only i2c has nulled functions
@@ -146,6 +174,8 @@ int tps65185_init(struct pl_epdpsu *psu, struct tps65185_info *p, struct pl_i2c
 		psu->on = tps65185_enable;
 		psu->off = tps65185_disable;
 	}
+	psu->get_rails = tps65185_get_rails;
+	psu->pmic = p;
 	return 0;
 }
 
@@ -227,19 +257,54 @@ int tps65185_wait_pok(struct pl_epdpsu *psu)
 }
 #endif
 
+int tps65185_get_rails(struct pl_epdpsu *psu)
+{
+	struct tps65185_info *pmic = psu->pmic;
+	uint8_t pgstat;
+
+	assert(pmic != NULL);
+
+	if (pl_i2c_reg_read_8(pmic->i2c, pmic->i2c_addr, HVPMIC_REG_PG_STAT,
+			      &pgstat))
+		return -1;
+
+	pgstat &= 0xFA;
+
+	if (pgstat == 0xFA)
+		return PL_EPDPSU_RAILS_GOOD;
+
+	return pgstat ? PL_EPDPSU_RAILS_PARTIAL : PL_EPDPSU_RAILS_OFF;
+}
+
 /* use the i2c interface to power up the PMIC */
 int tps65185_enable(struct pl_epdpsu *psu){
 	struct pl_epdpsu_i2c* p = psu->data;
 
 	int timeout, stat = pl_i2c_reg_write_8(p->i2c, 0x68 ,HVPMIC_REG_ENABLE, 0x80);
 
-	for (timeout = p->timeout_ms; timeout; timeout--) {
-		if (tps65185_wait_pok(psu))
-			break;
-		mdelay(1);
+	if (p->pok != PL_GPIO_NONE) {
+		timeout = 1;
+
+		/* POK is not wired to PWR_GOOD on all boards: the rails have
+		 * had the whole timeout to come up, so read the PG status once
+		 * rather than polling it for another timeout */
+		if (pl_gpio_wait(p->gpio, p->pok, 1, p->timeout_ms)) {
+			LOG("POK GPIO timeout, reading the PG status");
+
+			if (tps65185_wait_pok(psu) <= 0)
+				timeout = 0;
+		}
+	} else {
+		/* no POK line: poll the PG status */
+		for (timeout = p->timeout_ms; timeout > 0;
+		     timeout -= TPS65185_POK_POLL_MS) {
+			if (tps65185_wait_pok(psu) > 0)
+				break;
+			msleep(TPS65185_POK_POLL_MS);
+		}
 	}
 
-	if (!timeout) {
+	if (timeout <= 0) {
 		LOG("POK timeout");
 		return -1;
 	}
@@ -269,21 +334,33 @@ int tps65185_disable(struct pl_epdpsu *psu)
 	return stat;
 }
 
-int tps65185_temperature_measure(struct tps65185_info *p, int16_t *measured)
+/* TMST1 bits */
+#define TPS65185_TMST1_READ_THERM 0x80
+#define TPS65185_TMST1_CONV_END   0x20
+
+/* Maximum time to wait for a conversion in tps65185_temperature_measure */
+#define TPS65185_TEMP_TIMEOUT_MS  10
+
+static int tps65185_temp_start(struct pl_temp_sensor *s)
 {
-	int8_t temp;
+	struct tps65185_info *p = s->data;
+
+	return pl_i2c_reg_write_8(p->i2c, p->i2c_addr, HVPMIC_REG_TMST1,
+				  TPS65185_TMST1_READ_THERM);
+}
+
+static int tps65185_temp_collect(struct pl_temp_sensor *s, int16_t *measured)
+{
+	struct tps65185_info *p = s->data;
 	uint8_t progress;
+	int8_t temp;
 
-	/* Trigger conversion */
-	if (pl_i2c_reg_write_8(p->i2c, p->i2c_addr,HVPMIC_REG_TMST1, 0x80))
+	if (pl_i2c_reg_read_8(p->i2c, p->i2c_addr, HVPMIC_REG_TMST1,
+			      &progress))
 		return -1;
 
-	/* wait for it to complete */
-	do {
-		if (pl_i2c_reg_read_8(p->i2c, p->i2c_addr, HVPMIC_REG_TMST1,
-				      &progress))
-			return -1;
-	} while ((progress & 0x20));
+	if (!(progress & TPS65185_TMST1_CONV_END))
+		return 1;
 
 	/* read the temperature */
 	if (pl_i2c_reg_read_8(p->i2c, p->i2c_addr, HVPMIC_REG_TMST_VALUE,
@@ -300,3 +377,41 @@ int tps65185_temperature_measure(struct tps65185_info *p, int16_t *measured)
 
 	return 0;
 }
+
+void tps65185_temp_sensor_init(struct pl_temp_sensor *s,
+			       struct tps65185_info *p)
+{
+	assert(s != NULL);
+	assert(p != NULL);
+
+	s->start = tps65185_temp_start;
+	s->collect = tps65185_temp_collect;
+	s->data = p;
+	s->valid = 0;
+	s->busy = 0;
+}
+
+int tps65185_temperature_measure(struct tps65185_info *p, int16_t *measured)
+{
+	struct pl_temp_sensor s;
+	unsigned timeout;
+	int stat;
+
+	tps65185_temp_sensor_init(&s, p);
+
+	if (tps65185_temp_start(&s))
+		return -1;
+
+	for (timeout = TPS65185_TEMP_TIMEOUT_MS; timeout; --timeout) {
+		stat = tps65185_temp_collect(&s, measured);
+
+		if (stat != 1)
+			return stat;
+
+		msleep(1);
+	}
+
+	LOG("Temperature conversion timeout");
+
+	return -1;
+}
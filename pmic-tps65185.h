@@ -33,6 +33,7 @@
 
 struct pl_i2c;
 struct vcom_cal;
+struct pl_temp_sensor;
 
 struct tps65185_info {
 	struct pl_i2c *i2c;
@@ -46,9 +47,12 @@ extern int tps65185_set_vcom_voltage(struct tps65185_info *pmic, int mv);
 extern int tps65185_set_vcom_register(struct tps65185_info *pmic, int value);
 
 extern int tps65185_wait_pok(struct pl_epdpsu *psu);
+extern int tps65185_get_rails(struct pl_epdpsu *psu);
 extern int tps65185_enable(struct pl_epdpsu *psu);
 extern int tps65185_disable(struct pl_epdpsu *psu);
 
+extern void tps65185_temp_sensor_init(struct pl_temp_sensor *s,
+				      struct tps65185_info *pmic);
 extern int tps65185_temperature_measure(struct tps65185_info *pmic,
 					int16_t *measured);
 
@@ -58,9 +58,12 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "assert.h"
 #include "FatFs/ff.h"
 #include "pnm-utils.h"
+#include "image-pack.h"
+#include "utils.h"
 
 int pnm_read_int32(FIL *pnm_file, int32_t *value)
 {
@@ -97,8 +100,11 @@ int pnm_read_int32(FIL *pnm_file, int32_t *value)
 				break;
 			case '0': case '1': case '2': case '3': case '4':
 			case '5': case '6': case '7': case '8': case '9':
+				/* stop accumulating once out of range to avoid
+				 * overflows, the value is rejected anyway */
 				if (!in_comment) {
-					val = val * 10 + (ch - '0');
+					if (val <= 0xFFFF)
+						val = val * 10 + (ch - '0');
 					digits++;
 
 					if (f_eof(pnm_file)) {
@@ -119,44 +125,356 @@ int pnm_read_int32(FIL *pnm_file, int32_t *value)
 	return 0;
 }
 
+/* Same as pnm_read_int32 but from a buffer, with pos updated to point past
+ * the whitespace which terminates the number */
+static int pnm_parse_int(const uint8_t *buf, UINT len, UINT *pos,
+			 int32_t *value)
+{
+	int digits = 0;
+	int in_comment = 0;
+	int32_t val = 0;
+	UINT i;
+
+	for (i = *pos; i < len; ++i) {
+		const char ch = buf[i];
+
+		switch (ch)
+		{
+			case '#':
+				in_comment = 1;
+				break;
+			case ' ':
+			case '\t':
+			case '\r':
+			case '\n':
+				if (!in_comment && digits) {
+					*value = val;
+					*pos = i + 1;
+					return 0;
+				}
+				if (ch == '\r' || ch == '\n')
+					in_comment = 0;
+				break;
+			case '0': case '1': case '2': case '3': case '4':
+			case '5': case '6': case '7': case '8': case '9':
+				/* stop accumulating once out of range to avoid
+				 * overflows, the value is rejected anyway */
+				if (!in_comment) {
+					if (val <= 0xFFFF)
+						val = val * 10 + (ch - '0');
+					digits++;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	return -1;
+}
+
+static int pnm_check_header(struct pnm_header *hdr, int32_t width,
+			    int32_t height, int32_t max_gray)
+{
+	if ((width <= 0) || (width > 0x7FFF) ||
+	    (height <= 0) || (height > 0x7FFF) ||
+	    (max_gray <= 0) || (max_gray > 0xFFFF))
+		return -1;
+
+	hdr->width = width;
+	hdr->height = height;
+	hdr->max_gray = max_gray;
+
+	return 0;
+}
+
+static int pnm_parse_type(const char *magic, struct pnm_header *hdr)
+{
+	hdr->type = PNM_UNKNOWN;
+
+	if (magic[0] != 'P')
+		return -1;
+
+	if (magic[1] == '4')
+		hdr->type = PNM_BITMAP;
+	else if (magic[1] == '5')
+		hdr->type = PNM_GREYSCALE;
+	else
+		return -1;
+
+	return 0;
+}
+
+/* Read the header one byte at a time, for headers which do not fit in the
+ * buffer such as ones with long comments */
+static int pnm_stream_header(FIL *pnm_file, struct pnm_header *hdr)
+{
+	char magic[2];
+	int32_t width, height, max_gray;
+	UINT count;
+
+	hdr->type = PNM_UNKNOWN;
+
+	if ((f_read(pnm_file, magic, 2, &count) != FR_OK) || (count != 2))
+		return -1;
+
+	if (pnm_parse_type(magic, hdr))
+		return -1;
+
+	max_gray = 1;
+
+	if (pnm_read_int32(pnm_file, &width) ||
+	    pnm_read_int32(pnm_file, &height))
+		return -1;
+
+	if ((hdr->type == PNM_GREYSCALE) &&
+	    pnm_read_int32(pnm_file, &max_gray))
+		return -1;
+
+	/* read pointer is now positioned at start of image data */
+	return pnm_check_header(hdr, width, height, max_gray);
+}
+
+int pnm_parse_header(const uint8_t *buf, UINT len, struct pnm_header *hdr)
+{
+	int32_t width, height, max_gray;
+	UINT pos = 2;
+
+	assert(buf != NULL);
+	assert(hdr != NULL);
+
+	hdr->type = PNM_UNKNOWN;
+
+	if ((len < 2) || pnm_parse_type((const char *)buf, hdr))
+		return -1;
+
+	max_gray = 1;
+
+	if (pnm_parse_int(buf, len, &pos, &width) ||
+	    pnm_parse_int(buf, len, &pos, &height))
+		return -1;
+
+	if ((hdr->type == PNM_GREYSCALE) &&
+	    pnm_parse_int(buf, len, &pos, &max_gray))
+		return -1;
+
+	if (pnm_check_header(hdr, width, height, max_gray))
+		return -1;
+
+	return pos;
+}
+
 int pnm_read_header(FIL *pnm_file, struct pnm_header *hdr)
 {
-	char buffer[2];
+	uint8_t buffer[PNM_HEADER_MAX_LENGTH];
+	const DWORD start = pnm_file->fptr;
 	UINT count;
+	int offset;
 
 	assert(pnm_file);
 	assert(hdr);
 
-	hdr->type = PNM_UNKNOWN;
+	if (f_read(pnm_file, buffer, sizeof(buffer), &count) != FR_OK)
+		return -1;
 
-	if (f_read(pnm_file,buffer,2,&count) != FR_OK)
-		goto read_error;
+	offset = pnm_parse_header(buffer, count, hdr);
 
-	if (buffer[0] != 'P')
-		goto format_error;
+	if ((offset < 0) && (count == sizeof(buffer))) {
+		/* the header may be longer than the buffer */
+		if (f_lseek(pnm_file, start) != FR_OK)
+			return -1;
 
-	if (buffer[1] == '4')
-		hdr->type = PNM_BITMAP;
-	else if (buffer[1] == '5')
-		hdr->type = PNM_GREYSCALE;
-	else
-		goto format_error;
+		return pnm_stream_header(pnm_file, hdr);
+	}
+
+	if (offset < 0)
+		return -1;
+
+	/* move the read pointer to the start of the image data */
+	if (f_lseek(pnm_file, start + offset) != FR_OK)
+		return -1;
+
+	return 0;
+}
+
+int pnm_prefetch(struct pnm_file *img, uint8_t *buf, UINT buf_size)
+{
+	img->data_offset = img->f.fptr;
+	img->pos = 0;
+	img->buf = buf;
+	img->buf_len = 0;
+	img->flags = 0;
+
+	if ((buf != NULL) &&
+	    (f_read(&img->f, buf, buf_size, &img->buf_len) != FR_OK))
+		return -1;
+
+	return 0;
+}
 
-	hdr->max_gray = 1;
-	hdr->width = pnm_read_int(pnm_file);
-	hdr->height = pnm_read_int(pnm_file);
+int pnm_open(struct pnm_file *img, const char *path, uint8_t *buf,
+	     UINT buf_size)
+{
+	char pack_path[MAX_PATH_LEN];
+	unsigned index;
+	UINT count;
+	int offset;
+	int stat;
+
+	assert(img != NULL);
+	assert(path != NULL);
+
+	stat = image_pack_parse_ref(path, pack_path, sizeof(pack_path), &index);
+
+	if (stat < 0)
+		return -1;
+
+	if (stat)
+		return image_pack_open(img, pack_path, index, buf, buf_size);
+
+	if (f_open(&img->f, path, FA_READ) != FR_OK)
+		return -1;
+
+	if ((buf == NULL) || (buf_size < PNM_HEADER_MAX_LENGTH)) {
+		if (pnm_read_header(&img->f, &img->hdr))
+			goto error_close;
+
+		if (pnm_prefetch(img, buf, buf_size))
+			goto error_close;
 
-	if (hdr->type == PNM_GREYSCALE) {
-		hdr->max_gray = pnm_read_int(pnm_file);
+		return 0;
 	}
-	// check to see if any of the data items were not read correctly
-	if (hdr->width <= 0 || hdr->height <= 0 || hdr->max_gray <= 0)
-		goto format_error;
 
-	// read pointer is now positioned at start of image data
+	/* read the header and the start of the pixel data in one go, the
+	 * data is then streamed from what follows the header in buf */
+	if (f_read(&img->f, buf, buf_size, &count) != FR_OK)
+		goto error_close;
+
+	offset = pnm_parse_header(buf, count, &img->hdr);
+
+	if ((offset < 0) && (count == buf_size)) {
+		/* the header may be longer than the buffer */
+		if ((f_lseek(&img->f, 0) != FR_OK) ||
+		    pnm_stream_header(&img->f, &img->hdr) ||
+		    pnm_prefetch(img, buf, buf_size))
+			goto error_close;
+
+		return 0;
+	}
+
+	if (offset < 0)
+		goto error_close;
+
+	img->data_offset = offset;
+	img->pos = 0;
+	img->buf = &buf[offset];
+	img->buf_len = count - offset;
+	img->flags = 0;
+
+	return 0;
+
+error_close:
+	f_close(&img->f);
+
+	return -1;
+}
+
+int pnm_open_ref(struct pnm_file *img, const struct pnm_ref *ref,
+		 uint8_t *buf, UINT buf_size)
+{
+	assert(img != NULL);
+	assert(ref != NULL);
+
+	if (f_open_cluster(&img->f, ref->sclust, ref->fsize) != FR_OK)
+		return -1;
+
+	if (f_lseek(&img->f, ref->data_offset) != FR_OK)
+		goto error_close;
+
+	img->hdr.type = PNM_GREYSCALE;
+	img->hdr.width = ref->width;
+	img->hdr.height = ref->height;
+	img->hdr.max_gray = 255;
+
+	if (pnm_prefetch(img, buf, buf_size))
+		goto error_close;
+
+	img->flags = ref->flags;
+
 	return 0;
 
-format_error:
-read_error:
+error_close:
+	f_close(&img->f);
+
 	return -1;
 }
+
+void pnm_get_ref(const struct pnm_file *img, struct pnm_ref *ref)
+{
+	assert(img != NULL);
+	assert(ref != NULL);
+
+	ref->sclust = img->f.org_clust;
+	ref->fsize = img->f.fsize;
+	ref->data_offset = img->data_offset;
+	ref->width = img->hdr.width;
+	ref->height = img->hdr.height;
+	ref->flags = img->flags;
+}
+
+int pnm_read(struct pnm_file *img, void *data, UINT n, UINT *count)
+{
+	uint8_t *out = data;
+	UINT total = 0;
+
+	assert(img != NULL);
+	assert(count != NULL);
+
+	if (img->pos < img->buf_len) {
+		UINT len = img->buf_len - img->pos;
+
+		if (len > n)
+			len = n;
+
+		memcpy(out, &img->buf[img->pos], len);
+		img->pos += len;
+		out += len;
+		n -= len;
+		total += len;
+	}
+
+	if (n) {
+		const DWORD fptr = img->data_offset + img->pos;
+		UINT len;
+
+		if ((img->f.fptr != fptr) && (f_lseek(&img->f, fptr) != FR_OK))
+			return -1;
+
+		if (f_read(&img->f, out, n, &len) != FR_OK)
+			return -1;
+
+		img->pos += len;
+		total += len;
+	}
+
+	*count = total;
+
+	return 0;
+}
+
+int pnm_seek(struct pnm_file *img, DWORD pos)
+{
+	assert(img != NULL);
+
+	/* the file pointer is only moved when reading past the buffer */
+	img->pos = pos;
+
+	return 0;
+}
+
+void pnm_close(struct pnm_file *img)
+{
+	assert(img != NULL);
+
+	f_close(&img->f);
+}
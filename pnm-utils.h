@@ -44,12 +44,77 @@ struct pnm_header {
 	int max_gray;
 };
 
+/* Length of the buffer used to parse a PNM header in one go when it is not
+ * read into a larger prefetch buffer, longer headers such as ones with long
+ * comments are read one byte at a time instead */
+#define PNM_HEADER_MAX_LENGTH 128
+
+/* Pixel data flags */
+#define PNM_FLAG_SCRAMBLED (1 << 0) /* already in the EPDC memory layout */
+
 #define pnm_read_int(_f) ({			\
 		int32_t _value;			\
 		pnm_read_int32(_f, &_value);	\
 		(int)_value; })
 
+/** PNM file opened for streaming its pixel data */
+struct pnm_file {
+	FIL f;
+	struct pnm_header hdr;
+	DWORD data_offset;	/* offset of the pixel data in the file */
+	DWORD pos;		/* current position in the pixel data */
+	const uint8_t *buf;	/* first bytes of pixel data, or NULL */
+	UINT buf_len;		/* number of bytes in buf */
+	uint8_t flags;		/* PNM_FLAG_xxx */
+};
+
+/** Location of the pixel data of an image, to open it again without any
+ * directory lookup or header parsing.  Packed to 17 bytes as it is used in
+ * RAM tables. */
+struct __attribute__((__packed__)) pnm_ref {
+	DWORD sclust;		/* file start cluster */
+	DWORD fsize;		/* file size */
+	DWORD data_offset;	/* offset of the pixel data in the file */
+	uint16_t width;
+	uint16_t height;
+	uint8_t flags;		/* PNM_FLAG_xxx */
+};
+
+/** Parse a PNM header from the first len bytes of a file and return the
+ * offset of the pixel data, or -1 if the header is invalid or incomplete */
+extern int pnm_parse_header(const uint8_t *buf, UINT len,
+			    struct pnm_header *hdr);
+
+/** Read the header and leave the file pointer at the start of the data */
 extern int pnm_read_header(FIL *pnm_file, struct pnm_header *hdr);
 extern int pnm_read_int32(FIL *pnm_file, int32_t *value);
 
+/** Open a PNM file, read its header and read up to buf_size bytes of pixel
+ * data into buf so the data can be streamed later without waiting for the
+ * SD card.  buf may be NULL.  The path may also be a reference to an image
+ * in a pack, see image-pack.h.  */
+extern int pnm_open(struct pnm_file *img, const char *path, uint8_t *buf,
+		    UINT buf_size);
+
+/** Open an image using a reference obtained with pnm_get_ref() */
+extern int pnm_open_ref(struct pnm_file *img, const struct pnm_ref *ref,
+			uint8_t *buf, UINT buf_size);
+
+/** Read the start of the pixel data, with the file pointer at its start */
+extern int pnm_prefetch(struct pnm_file *img, uint8_t *buf, UINT buf_size);
+
+/** Get a reference to an open image */
+extern void pnm_get_ref(const struct pnm_file *img, struct pnm_ref *ref);
+
+/** Read pixel data from the current position */
+extern int pnm_read(struct pnm_file *img, void *data, UINT n, UINT *count);
+
+/** Set the current position, relative to the start of the pixel data */
+extern int pnm_seek(struct pnm_file *img, DWORD pos);
+
+/** Get the current position, relative to the start of the pixel data */
+#define pnm_tell(_img) ((_img)->pos)
+
+extern void pnm_close(struct pnm_file *img);
+
 #endif /* PNM_UTILS_H */
@@ -30,6 +30,7 @@
 #include <pl/hwinfo.h>
 #include <pl/dispinfo.h>
 #include <pl/wflib.h>
+#include <pl/temp-sensor.h>
 #include <string.h>
 #include <stdio.h>
 #include "probe.h"
@@ -46,6 +47,20 @@
 /* ToDo: add to generic HV-PMIC interface */
 #define I2C_PMIC_ADDR_TPS65185 0x68
 #define I2C_PMIC_ADDR_MAX17135 0x48
+#define I2C_HWINFO_EEPROM_ADDR 0x50
+#define I2C_DISPINFO_EEPROM_ADDR 0x54
+
+/* Devices used to check the I2C bus speed, only the ones which respond with
+ * the default speed are checked */
+static const uint8_t i2c_speed_probe_addr[] = {
+	I2C_HWINFO_EEPROM_ADDR, I2C_DISPINFO_EEPROM_ADDR,
+	I2C_PMIC_ADDR_TPS65185, I2C_PMIC_ADDR_MAX17135,
+};
+
+/* Speeds to try in kHz, starting with the requested one */
+static const uint16_t i2c_speeds[] = { 1000, 400, 100 };
+
+static void probe_i2c_speed(struct pl_i2c *i2c, const char *name, int khz);
 
 int probe_hwinfo(struct pl_platform *plat, const struct i2c_eeprom *hw_eeprom,
 		 struct pl_hwinfo *hwinfo_eeprom,
@@ -107,7 +122,15 @@ int probe_i2c(struct pl_platform *plat, struct s1d135xx *s1d135xx,
 		assert_fail("Invalid I2C mode");
 	}
 
-	return stat;
+	if (stat)
+		return -1;
+
+	probe_i2c_speed(host_i2c, "host", global_config.i2c_host_khz);
+
+	if (plat->i2c == disp_i2c)
+		probe_i2c_speed(disp_i2c, "disp", global_config.i2c_disp_khz);
+
+	return 0;
 }
 
 int probe_dispinfo(struct pl_dispinfo *dispinfo, struct pl_wflib *wflib,
@@ -188,6 +211,10 @@ int probe_hvpmic(struct pl_platform *plat, struct vcom_cal *vcom_cal,
 		if (!stat)
 			stat = max17135_set_vcom_voltage(
 				g_max17135, plat->dispinfo->info.vcom);
+		if (!stat) {
+			plat->psu.get_rails = max17135_get_rails;
+			plat->psu.pmic = g_max17135;
+		}
 
 		break;
 	case HV_PMIC_TPS65185:
@@ -254,3 +281,151 @@ int probe_epdc(struct pl_platform *plat, struct s1d135xx *s1d135xx)
 
 	return stat;
 }
+
+int probe_psu_delays(struct pl_platform *plat,
+		     struct pl_epdpsu_gpio *epdpsu_gpio,
+		     struct pl_epdpsu_i2c *epdpsu_i2c, struct config *config)
+{
+	unsigned *on_delay_ms;
+	unsigned *off_delay_ms;
+	unsigned on_ms, off_ms;
+
+	if (plat->psu.data == epdpsu_gpio) {
+		on_delay_ms = &epdpsu_gpio->on_delay_ms;
+		off_delay_ms = &epdpsu_gpio->off_delay_ms;
+	} else if (plat->psu.data == epdpsu_i2c) {
+		on_delay_ms = &epdpsu_i2c->on_delay_ms;
+		off_delay_ms = &epdpsu_i2c->off_delay_ms;
+	} else {
+		return 0;
+	}
+
+	/* a delay missing from the config keeps its default value */
+	if ((config->psu_on_delay_ms > 0) || (config->psu_off_delay_ms > 0)) {
+		if (config->psu_on_delay_ms > 0)
+			*on_delay_ms = config->psu_on_delay_ms;
+		else
+			LOG("psu_on_delay not set, using the default");
+
+		if (config->psu_off_delay_ms > 0)
+			*off_delay_ms = config->psu_off_delay_ms;
+		else
+			LOG("psu_off_delay not set, using the default");
+
+		LOG("EPD PSU delays: on %u ms, off %u ms",
+		    *on_delay_ms, *off_delay_ms);
+		return 0;
+	}
+
+	if (!config->psu_calibrate || (plat->psu.get_rails == NULL))
+		return 0;
+
+	LOG("Calibrating EPD PSU delays");
+	on_ms = *on_delay_ms;
+	off_ms = *off_delay_ms;
+	*on_delay_ms = 0;
+	*off_delay_ms = 0;
+
+	if (pl_epdpsu_calibrate(&plat->psu, &on_ms, &off_ms)) {
+		LOG("Calibration failed, using default delays");
+		*on_delay_ms = on_ms;
+		*off_delay_ms = off_ms;
+		return 0;
+	}
+
+	*on_delay_ms = on_ms;
+	*off_delay_ms = off_ms;
+	config->psu_on_delay_ms = on_ms;
+	config->psu_off_delay_ms = off_ms;
+
+	if (save_config(config))
+		LOG("Failed to save the calibrated delays");
+
+	return 0;
+}
+
+/* interim solution, like g_max17135 */
+static struct pl_temp_sensor g_temp_sensor;
+
+int probe_temp_sensor(struct pl_platform *plat,
+		      struct tps65185_info *pmic_info)
+{
+	static const char px[] = "Temperature: ";
+	struct pl_epdc *epdc = &plat->epdc;
+
+	switch (plat->hwinfo->board.hv_pmic) {
+	case HV_PMIC_MAX17135:
+		if (max17135_temp_enable(g_max17135))
+			return -1;
+		max17135_temp_sensor_init(&g_temp_sensor, g_max17135);
+		break;
+	case HV_PMIC_TPS65185:
+		tps65185_temp_sensor_init(&g_temp_sensor, pmic_info);
+		break;
+	default:
+		LOG("%sno HV-PMIC sensor", px);
+		return -1;
+	}
+
+	if (epdc->set_temp_mode(epdc, PL_EPDC_TEMP_MANUAL))
+		return -1;
+
+	epdc->temp_sensor = &g_temp_sensor;
+	LOG("%sHV-PMIC sensor", px);
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * static functions
+ */
+
+/* Try the requested speed then the slower ones until all the devices which
+ * were found with the default speed also respond, or go back to the default
+ * speed */
+static void probe_i2c_speed(struct pl_i2c *i2c, const char *name, int khz)
+{
+	const uint16_t default_khz = i2c->khz;
+	uint8_t found[ARRAY_SIZE(i2c_speed_probe_addr)];
+	uint8_t data;
+	int n = 0;
+	int i;
+	int j;
+
+	if (!khz || (khz == default_khz)) {
+		LOG("I2C %s: %u kHz", name, i2c->khz);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(i2c_speed_probe_addr); ++i)
+		if (!i2c->read(i2c, i2c_speed_probe_addr[i], &data, 1, 0))
+			found[n++] = i2c_speed_probe_addr[i];
+
+	if (!n) {
+		LOG("I2C %s: no device found, %u kHz", name, i2c->khz);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(i2c_speeds); ++i) {
+		if ((i2c_speeds[i] > khz) || (i2c_speeds[i] == default_khz))
+			continue;
+
+		if (pl_i2c_set_speed(i2c, i2c_speeds[i]))
+			continue;
+
+		for (j = 0; j < n; ++j)
+			if (i2c->read(i2c, found[j], &data, 1, 0))
+				break;
+
+		if (j == n)
+			break;
+
+		LOG("I2C %s: device 0x%02X failed at %u kHz", name, found[j],
+		    i2c->khz);
+	}
+
+	if (i == ARRAY_SIZE(i2c_speeds))
+		pl_i2c_set_speed(i2c, default_khz);
+
+	LOG("I2C %s: %u kHz (requested %d kHz)", name, i2c->khz, khz);
+}
@@ -37,6 +37,8 @@ struct i2c_eeprom;
 struct pl_wflib_eeprom_ctx;
 struct vcom_cal;
 struct pl_epdpsu_gpio;
+struct pl_epdpsu_i2c;
+struct config;
 struct tps65185_info;
 
 extern int probe_hwinfo(struct pl_platform *plat,
@@ -53,5 +55,11 @@ extern int probe_hvpmic(struct pl_platform *plat, struct vcom_cal *vcom_cal,
 			struct pl_epdpsu_gpio *epdpsu_gpio, struct pl_epdpsu_i2c *epdpsu_i2c,
 			struct tps65185_info *pmic_info);
 extern int probe_epdc(struct pl_platform *plat, struct s1d135xx *s1d135xx);
+extern int probe_psu_delays(struct pl_platform *plat,
+			    struct pl_epdpsu_gpio *epdpsu_gpio,
+			    struct pl_epdpsu_i2c *epdpsu_i2c,
+			    struct config *config);
+extern int probe_temp_sensor(struct pl_platform *plat,
+			     struct tps65185_info *pmic_info);
 
 #endif /* INCLUDE_PROBE_H */
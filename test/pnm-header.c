@@ -0,0 +1,273 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2014 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * test/pnm-header.c -- Host test for the PNM header parsers
+ *
+ * Build and run on the host from the top directory with:
+ *
+ *   cc -I. -o pnm-header test/pnm-header.c pnm-utils.c && ./pnm-header
+ *
+ * The FatFs functions are replaced with a file held in memory, so this also
+ * covers pnm_read_header() and pnm_open() with headers which do not fit in
+ * their buffer.  It returns 0 if all the tests pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FatFs/ff.h"
+#include "pnm-utils.h"
+#include "image-pack.h"
+
+/* Number of random headers to parse */
+#define FUZZ_ITERATIONS 100000
+
+static const uint8_t *file_data;
+static DWORD file_size;
+static int n_failed;
+static int n_tests;
+
+/* -- FatFs stand-ins -- */
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+	fp->fptr = 0;
+	fp->fsize = file_size;
+
+	return FR_OK;
+}
+
+FRESULT f_open_cluster(FIL *fp, DWORD sclust, DWORD fsize)
+{
+	return FR_INT_ERR;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+	const DWORD left = fp->fsize - fp->fptr;
+
+	if (btr > left)
+		btr = left;
+
+	memcpy(buff, &file_data[fp->fptr], btr);
+	fp->fptr += btr;
+	*br = btr;
+
+	return FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, DWORD ofs)
+{
+	if (ofs > fp->fsize)
+		return FR_INT_ERR;
+
+	fp->fptr = ofs;
+
+	return FR_OK;
+}
+
+FRESULT f_close(FIL *fp)
+{
+	return FR_OK;
+}
+
+int image_pack_parse_ref(const char *ref, char *path, size_t n,
+			 unsigned *index)
+{
+	return 0;
+}
+
+int image_pack_open(struct pnm_file *img, const char *path, unsigned index,
+		    uint8_t *buf, UINT buf_size)
+{
+	return -1;
+}
+
+/* -- tests -- */
+
+static void check(int cond, const char *name, const char *what)
+{
+	++n_tests;
+
+	if (!cond) {
+		printf("FAIL: %s: %s\n", name, what);
+		++n_failed;
+	}
+}
+
+static void use_file(const char *data, size_t len)
+{
+	file_data = (const uint8_t *)data;
+	file_size = len;
+}
+
+/* Parse a complete header followed by some pixel data with all the parsers,
+ * offset is the expected start of the pixel data or -1 if invalid */
+static void test_header(const char *name, const char *data, int offset,
+			int width, int height, int max_gray)
+{
+	const size_t len = strlen(data);
+	struct pnm_header hdr;
+	struct pnm_file img;
+	uint8_t buf[64];
+	FIL f;
+	int ret;
+
+	ret = pnm_parse_header((const uint8_t *)data, len, &hdr);
+	check(ret == offset, name, "pnm_parse_header offset");
+
+	if ((offset >= 0) && (ret == offset)) {
+		check(hdr.width == width, name, "width");
+		check(hdr.height == height, name, "height");
+		check(hdr.max_gray == max_gray, name, "max_gray");
+	}
+
+	use_file(data, len);
+	f_open(&f, name, FA_READ);
+	ret = pnm_read_header(&f, &hdr);
+	check((ret == 0) == (offset >= 0), name, "pnm_read_header status");
+
+	if ((offset >= 0) && !ret) {
+		check(f.fptr == offset, name, "pnm_read_header data offset");
+		check(hdr.width == width, name, "pnm_read_header width");
+	}
+
+	ret = pnm_open(&img, name, buf, sizeof(buf));
+	check((ret == 0) == (offset >= 0), name, "pnm_open status");
+
+	if ((offset >= 0) && !ret) {
+		check(img.data_offset == offset, name, "pnm_open data offset");
+		check(img.hdr.height == height, name, "pnm_open height");
+		check((img.buf_len > 0) && (img.buf[0] == data[offset]),
+		      name, "pnm_open prefetched data");
+	}
+}
+
+/* All the strict prefixes of a header must be rejected as incomplete */
+static void test_truncated(const char *name, const char *data, size_t len)
+{
+	struct pnm_header hdr;
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		check(pnm_parse_header((const uint8_t *)data, i, &hdr) < 0,
+		      name, "truncated header accepted");
+}
+
+static void test_long_comment(void)
+{
+	static char data[1024];
+	const size_t comment_len = 600;
+	int offset;
+
+	strcpy(data, "P5\n# ");
+	memset(&data[5], 'x', comment_len);
+	strcpy(&data[5 + comment_len], "\n1280 960\n255\n");
+	offset = strlen(data);
+	strcat(data, "pixel data");
+
+	/* longer than the pnm_read_header() and pnm_open() buffers, which
+	 * then fall back to streaming the header */
+	test_header("long comment", data, offset, 1280, 960, 255);
+}
+
+/* Random bytes and mutations of a valid header must never be accepted with
+ * out of range values or an offset past the end of the buffer */
+static void test_fuzz(void)
+{
+	static const char valid[] = "P5\n# comment\n 1280\t960\r\n255\n";
+	uint8_t buf[48];
+	unsigned i;
+
+	srand(1);
+
+	for (i = 0; i < FUZZ_ITERATIONS; ++i) {
+		struct pnm_header hdr;
+		const size_t len = rand() % sizeof(buf);
+		unsigned j;
+		int ret;
+
+		if (i & 1) {
+			for (j = 0; j < len; ++j)
+				buf[j] = rand();
+		} else {
+			memcpy(buf, valid, sizeof(buf) < sizeof(valid) ?
+			       sizeof(buf) : sizeof(valid));
+
+			for (j = rand() % 4; j; --j)
+				buf[rand() % sizeof(buf)] = "P54 #\n\t09x"
+					[rand() % 10];
+		}
+
+		ret = pnm_parse_header(buf, len, &hdr);
+
+		if (ret < 0)
+			continue;
+
+		++n_tests;
+
+		if ((ret > len) || (hdr.width <= 0) ||
+		    (hdr.width > 0x7FFF) || (hdr.height <= 0) ||
+		    (hdr.height > 0x7FFF) || (hdr.max_gray <= 0) ||
+		    (hdr.max_gray > 0xFFFF)) {
+			printf("FAIL: fuzz %u: offset %d, %dx%d, max %d\n",
+			       i, ret, hdr.width, hdr.height, hdr.max_gray);
+			++n_failed;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const char simple[] = "P5 24 7 15\n";
+
+	test_header("simple", "P5 24 7 15\ndata", 11, 24, 7, 15);
+	test_header("bitmap", "P4\n24 7\ndata", 8, 24, 7, 1);
+	test_header("comments", "P5\n# A comment\n24 7\n# Another\n255\ndata",
+		    34, 24, 7, 255);
+	test_header("inline comment", "P5\n24 # the width 99\n7\n255\ndata",
+		    27, 24, 7, 255);
+	test_header("comment digits", "P5 #1 2 3\n24 7 255\ndata",
+		    19, 24, 7, 255);
+	test_header("whitespace", "P5\t\r\n 24\r\n\t7  255\ndata",
+		    18, 24, 7, 255);
+	test_header("limits", "P5 32767 32767 65535\ndata",
+		    21, 32767, 32767, 65535);
+	test_header("wide", "P5 32768 7 255\ndata", -1, 0, 0, 0);
+	test_header("max gray", "P5 24 7 65536\ndata", -1, 0, 0, 0);
+	test_header("overflow", "P5 99999999999999999999 7 255\ndata",
+		    -1, 0, 0, 0);
+	test_header("overflow height", "P5 24 4294967297 255\ndata",
+		    -1, 0, 0, 0);
+	test_header("zero", "P5 0 7 255\ndata", -1, 0, 0, 0);
+	test_header("no max gray", "P5 24 7 ", -1, 0, 0, 0);
+	test_header("colour", "P6 24 7 255\ndata", -1, 0, 0, 0);
+	test_header("ascii", "P2 24 7 255\ndata", -1, 0, 0, 0);
+	test_header("magic", "X5 24 7 255\ndata", -1, 0, 0, 0);
+	test_header("empty", "", -1, 0, 0, 0);
+	test_truncated("truncated", simple, sizeof(simple) - 1);
+	test_truncated("truncated comments",
+		       "P5\n# A comment\n24 7\n255\n", 24);
+	test_long_comment();
+	test_fuzz();
+
+	printf("%d tests, %d failed\n", n_tests, n_failed);
+
+	return n_failed ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+# Produce image pack files for Plastic Logic displays
+
+# Copyright (C) 2013 Plastic Logic Limited
+#
+# This program is free software: you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# The pack format is described in image-pack.h.  Images can then be used as
+# "slides.pak:0", "slides.pak:1" etc. in the sequencer, and all the images in
+# the packs found in the slideshow directory are shown by the slideshow.
+
+from __future__ import print_function
+
+import sys
+import argparse
+import struct
+from PIL import Image
+
+MAGIC = b'PLPK'
+VERSION = 1
+HEADER = struct.Struct('<4sHH')
+ENTRY = struct.Struct('<HHBBHII')
+FLAG_SCRAMBLED = (1 << 0)
+ALIGN = 512
+
+def align(offset):
+    "Round up to the next sector boundary"
+    return (offset + ALIGN - 1) & ~(ALIGN - 1)
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description="Produce image pack files for Plastic Logic displays")
+    parser.add_argument('output_file', help="path to the output pack file")
+    parser.add_argument('input_files', nargs='+',
+                        help="paths to the input image files, in order")
+    parser.add_argument('--scrambled', action='store_true',
+                        help="images are already in the EPDC memory layout "
+                        "(i.e. produced with prepare_pgm.py --interleave for "
+                        "the target display)")
+    args = parser.parse_args(argv[1:])
+
+    flags = FLAG_SCRAMBLED if args.scrambled else 0
+    images = []
+
+    for input_file in args.input_files:
+        print("Opening {}".format(input_file))
+        img = Image.open(input_file).convert('L')
+        w, h = img.size
+        if w % 2:
+            print("Image width must be even: {}".format(w))
+            return False
+        images.append(img)
+
+    offset = align(HEADER.size + (ENTRY.size * len(images)))
+    entries = []
+
+    for i, img in enumerate(images):
+        w, h = img.size
+        size = w * h
+        print("{:3d}: {}x{} at 0x{:08X}".format(i, w, h, offset))
+        entries.append(ENTRY.pack(w, h, 8, flags, 0, offset, size))
+        offset = align(offset + size)
+
+    print("Saving {} images as {}".format(len(images), args.output_file))
+
+    with open(args.output_file, 'wb') as out:
+        out.write(HEADER.pack(MAGIC, VERSION, len(images)))
+        for entry in entries:
+            out.write(entry)
+        for img in images:
+            out.write(b'\0' * (align(out.tell()) - out.tell()))
+            out.write(img.tobytes())
+
+    return True
+
+if __name__ == '__main__':
+    ret = main(sys.argv)
+    sys.exit(0 if ret is True else 1)
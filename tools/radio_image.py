@@ -0,0 +1,176 @@
+# Produce and check BasicRF image transfer messages for Plastic Logic displays
+
+# Copyright (C) 2014 Plastic Logic Limited
+#
+# This program is free software: you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# The protocol is described in app/radio-image.h.  This stands in for the
+# sender: the messages for an image are saved in a file, one record per
+# BasicRF packet made of a length byte followed by the payload.  A BasicRF
+# node can then send each record as a packet, leaving PACKET_GAP_MS between
+# them.  With --check, the records are decoded with the same checks as the
+# firmware receiver.
+
+from __future__ import print_function
+
+import sys
+import argparse
+import struct
+
+MAX_PAYLOAD = 116
+START = struct.Struct('<BBBBHHHH')
+DATA = struct.Struct('<BBH')
+END = struct.Struct('<BBHH')
+CHUNK = MAX_PAYLOAD - DATA.size
+PACKET_GAP_MS = 5
+
+# Keep in sync with enum radio_image_type in app/radio-image.h
+TYPE_START = 0x01
+TYPE_DATA = 0x02
+TYPE_END = 0x03
+
+def crc16(data, crc=0xFFFF):
+    "Same as crc16_run() in the firmware"
+    for byte in bytearray(data):
+        crc ^= byte << 8
+        for bit in range(8):
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+            else:
+                crc = (crc << 1) & 0xFFFF
+    return crc
+
+def encode(pixels, left, top, width, height, wfid, image_id):
+    "Return the list of messages to send an image area"
+    if len(pixels) % 2:
+        pixels += b'\0'
+
+    packets = [START.pack(TYPE_START, image_id, wfid, 0,
+                          left, top, width, height)]
+    seq = 0
+
+    for offset in range(0, len(pixels), CHUNK):
+        chunk = pixels[offset:(offset + CHUNK)]
+        packets.append(DATA.pack(TYPE_DATA, image_id, seq) + chunk)
+        seq += 1
+
+    packets.append(END.pack(TYPE_END, image_id, seq, crc16(pixels)))
+
+    return packets
+
+def write(path, packets):
+    with open(path, 'wb') as f:
+        for packet in packets:
+            f.write(struct.pack('B', len(packet)))
+            f.write(packet)
+
+def read(path):
+    packets = []
+
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    offset = 0
+    while offset < len(data):
+        length = bytearray(data[offset:(offset + 1)])[0]
+        packets.append(data[(offset + 1):(offset + 1 + length)])
+        offset += 1 + length
+
+    return packets
+
+def check(packets):
+    "Decode the messages like the firmware, return the number of images"
+    images = 0
+    image = None
+
+    for packet in packets:
+        msg_type = bytearray(packet[:1])[0]
+
+        if msg_type == TYPE_START:
+            _, image_id, wfid, _, left, top, w, h = START.unpack(packet)
+            print("Image {}: ({}, {}) {}x{} wfid {}".format(
+                image_id, left, top, w, h, wfid))
+            image = {'id': image_id, 'seq': 0, 'data': b'',
+                     'size': (w * h + 1) & ~1}
+        elif msg_type == TYPE_DATA:
+            _, image_id, seq = DATA.unpack_from(packet)
+            if image is None or image_id != image['id'] or \
+               seq < image['seq']:
+                continue
+            chunk = packet[DATA.size:]
+            if seq > image['seq'] or len(chunk) % 2 or \
+               len(image['data']) + len(chunk) > image['size']:
+                print("Invalid chunk {}, image aborted".format(seq))
+                image = None
+                continue
+            image['data'] += chunk
+            image['seq'] += 1
+        elif msg_type == TYPE_END:
+            _, image_id, chunks, crc = END.unpack(packet)
+            if image is None or image_id != image['id']:
+                continue
+            if chunks != image['seq'] or \
+               len(image['data']) != image['size'] or \
+               crc != crc16(image['data']):
+                print("Image {} rejected".format(image_id))
+            else:
+                print("Image {}: {} bytes in {} chunks, CRC 0x{:04X}".format(
+                    image_id, image['size'], chunks, crc))
+                images += 1
+            image = None
+        else:
+            print("Invalid message type: {}".format(msg_type))
+
+    return images
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description="Produce or check BasicRF image transfer messages")
+    parser.add_argument('packet_file', help="path to the packet file")
+    parser.add_argument('input_file', nargs='?',
+                        help="path to the input image file")
+    parser.add_argument('--left', type=int, default=0,
+                        help="left coordinate of the area on the display")
+    parser.add_argument('--top', type=int, default=0,
+                        help="top coordinate of the area on the display")
+    parser.add_argument('--wfid', type=int, default=2,
+                        help="waveform id, as in the sequencer")
+    parser.add_argument('--id', type=int, default=0,
+                        help="image id, to tell consecutive images apart")
+    parser.add_argument('--check', action='store_true',
+                        help="decode the packet file instead")
+    args = parser.parse_args(argv[1:])
+
+    if args.check:
+        return check(read(args.packet_file)) > 0
+
+    if args.input_file is None:
+        print("Input image file required")
+        return False
+
+    from PIL import Image
+
+    img = Image.open(args.input_file).convert('L')
+    w, h = img.size
+    packets = encode(img.tobytes(), args.left, args.top, w, h, args.wfid,
+                     (args.id & 0xFF))
+    print("Saving {}x{} image as {} packets in {}".format(
+        w, h, len(packets), args.packet_file))
+    write(args.packet_file, packets)
+
+    return True
+
+if __name__ == '__main__':
+    ret = main(sys.argv)
+    sys.exit(0 if ret is True else 1)
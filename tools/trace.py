@@ -0,0 +1,137 @@
+# Create and decode performance trace files for Plastic Logic displays
+
+# Copyright (C) 2013 Plastic Logic Limited
+#
+# This program is free software: you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# The trace file format is described in trace.h.  The firmware only records
+# events when trace.bin is present in the root directory of the SD card, so
+# create it first with "trace.py --create trace.bin", then copy it back and
+# run "trace.py trace.bin" to print the latency statistics of each event.
+
+from __future__ import print_function
+
+import sys
+import argparse
+import struct
+
+MAGIC = 0x52544C50
+BLOCK_SIZE = 512
+BLOCK_HEADER = struct.Struct('<IIHHI')
+ENTRY = struct.Struct('<IHBB')
+END = 0x80
+TICKS_PER_SECOND = 32768.0
+
+# Keep in sync with enum trace_event_id in trace.h
+EVENTS = {
+    1: 'load_image',
+    2: 'update',
+    3: 'wait_update_end',
+    4: 'wait_idle',
+    5: 'load_wflib',
+    6: 'flush',
+    7: 'psu_on',
+    8: 'cpu_idle',
+}
+
+def read_blocks(path):
+    "Return the valid blocks sorted by sequence number"
+    blocks = []
+
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    for offset in range(0, len(data) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        magic, seq, count, dropped, _ = BLOCK_HEADER.unpack_from(data, offset)
+        if magic != MAGIC:
+            continue
+        entries = []
+        for i in range(count):
+            entries.append(ENTRY.unpack_from(
+                    data, offset + BLOCK_HEADER.size + (i * ENTRY.size)))
+        blocks.append((seq, dropped, entries))
+
+    return sorted(blocks)
+
+def ms(ticks):
+    return ticks * 1000.0 / TICKS_PER_SECOND
+
+def decode(path):
+    blocks = read_blocks(path)
+
+    if not blocks:
+        print("No trace data found in {}".format(path))
+        return False
+
+    stats = {}
+    started = {}
+    dropped = 0
+    prev_time = None
+
+    for seq, block_dropped, entries in blocks:
+        dropped += block_dropped
+        for time, arg, event_id, _ in entries:
+            # a time going backwards means the device has been reset
+            if prev_time is not None and time < prev_time:
+                started = {}
+            prev_time = time
+            event = event_id & ~END
+            if event_id & END:
+                start = started.pop(event, None)
+                if start is None:
+                    continue
+                stats.setdefault(event, []).append(time - start)
+            else:
+                started[event] = time
+
+    print("{} blocks, sequence {} to {}, {} events dropped".format(
+            len(blocks), blocks[0][0], blocks[-1][0], dropped))
+    print("{:16s} {:>6s} {:>10s} {:>10s} {:>10s} {:>10s}".format(
+            "event", "count", "min ms", "avg ms", "max ms", "total ms"))
+
+    for event in sorted(stats):
+        d = stats[event]
+        print("{:16s} {:6d} {:10.2f} {:10.2f} {:10.2f} {:10.1f}".format(
+                EVENTS.get(event, str(event)), len(d), ms(min(d)),
+                ms(sum(d) / float(len(d))), ms(max(d)), ms(sum(d))))
+
+    return True
+
+def create(path, size):
+    blocks = (size * 1024) // BLOCK_SIZE
+    print("Creating {} with {} blocks".format(path, blocks))
+
+    with open(path, 'wb') as f:
+        f.write(b'\0' * (blocks * BLOCK_SIZE))
+
+    return True
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description="Create or decode a trace file")
+    parser.add_argument('trace_file', help="trace file, usually trace.bin")
+    parser.add_argument('--create', action='store_true',
+                        help="create an empty trace file")
+    parser.add_argument('--size', type=int, default=64,
+                        help="size of the file to create in KB")
+    args = parser.parse_args(argv[1:])
+
+    if args.create:
+        return create(args.trace_file, args.size)
+
+    return decode(args.trace_file)
+
+if __name__ == '__main__':
+    ret = main(sys.argv)
+    sys.exit(0 if ret is True else 1)
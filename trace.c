@@ -0,0 +1,195 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * trace.c -- Performance trace log
+ *
+ */
+
+#include <FatFs/ff.h>
+#include <stddef.h>
+#include <string.h>
+#include "assert.h"
+#include "trace.h"
+
+#define LOG_TAG "trace"
+#include "utils.h"
+
+#if CONFIG_TRACE
+
+/* Maximum number of seconds events are kept in RAM by trace_poll() */
+#define TRACE_FLUSH_PERIOD 10
+
+static struct trace_block trace_block;
+static FIL trace_file;
+static uint16_t trace_nblocks;		/* 0 when tracing is disabled */
+static uint16_t trace_pos;		/* next block to write in the file */
+static uint32_t trace_seq;
+
+static int read_block_header(uint16_t n, struct trace_block *hdr)
+{
+	UINT count;
+
+	if (f_lseek(&trace_file, (DWORD)n * TRACE_BLOCK_SIZE) != FR_OK)
+		return -1;
+
+	if (f_read(&trace_file, hdr, offsetof(struct trace_block, entries),
+		   &count) != FR_OK)
+		return -1;
+
+	if ((count != offsetof(struct trace_block, entries)) ||
+	    (hdr->magic != TRACE_MAGIC))
+		hdr->magic = 0;
+
+	return 0;
+}
+
+int trace_init(const char *path)
+{
+	struct trace_block *hdr = &trace_block;
+	uint32_t seq0;
+	uint16_t lo, hi;
+
+	assert(path != NULL);
+
+	trace_nblocks = 0;
+
+	if (f_open(&trace_file, path, FA_READ | FA_WRITE | FA_OPEN_EXISTING)
+	    != FR_OK)
+		return 0;
+
+	if (read_block_header(0, hdr))
+		goto error_close;
+
+	/* Blocks are written in sequence from the start of the file, so find
+	 * the first one which does not follow block 0 */
+	if (hdr->magic) {
+		seq0 = hdr->seq;
+		lo = 1;
+		hi = trace_file.fsize / TRACE_BLOCK_SIZE;
+
+		while (lo < hi) {
+			const uint16_t mid = lo + (hi - lo) / 2;
+
+			if (read_block_header(mid, hdr))
+				goto error_close;
+
+			if (hdr->magic && (hdr->seq == (seq0 + mid)))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		trace_pos = lo;
+		trace_seq = seq0 + lo;
+	} else {
+		trace_pos = 0;
+		trace_seq = 0;
+	}
+
+	trace_nblocks = trace_file.fsize / TRACE_BLOCK_SIZE;
+
+	if (!trace_nblocks)
+		goto error_close;
+
+	if (trace_pos == trace_nblocks)
+		trace_pos = 0;
+
+	memset(&trace_block, 0, sizeof(trace_block));
+	trace_block.magic = TRACE_MAGIC;
+	LOG("Tracing to %s, %u blocks, resuming at %u", path, trace_nblocks,
+	    trace_pos);
+
+	return 0;
+
+error_close:
+	LOG("Failed to initialise trace file");
+	trace_nblocks = 0;
+	f_close(&trace_file);
+
+	return -1;
+}
+
+void trace_event(uint8_t id, uint16_t arg)
+{
+	struct trace_entry *entry;
+
+	if (!trace_nblocks)
+		return;
+
+	if (trace_block.count == TRACE_BLOCK_ENTRIES) {
+		++trace_block.dropped;
+		return;
+	}
+
+	entry = &trace_block.entries[trace_block.count++];
+	entry->time = time_ticks();
+	entry->arg = arg;
+	entry->id = id;
+}
+
+int trace_poll(void)
+{
+	uint32_t age;
+
+	if (!trace_nblocks || !trace_block.count)
+		return 0;
+
+	age = time_ticks() - trace_block.entries[0].time;
+
+	if ((trace_block.count < (TRACE_BLOCK_ENTRIES / 2)) &&
+	    (age < (TRACE_FLUSH_PERIOD * TIME_TICKS_PER_SECOND)))
+		return 0;
+
+	return trace_flush();
+}
+
+int trace_flush(void)
+{
+	UINT count;
+
+	if (!trace_nblocks || !trace_block.count)
+		return 0;
+
+	trace_event(TRACE_FLUSH, trace_block.count);
+	trace_block.seq = trace_seq;
+
+	if ((f_lseek(&trace_file, (DWORD)trace_pos * TRACE_BLOCK_SIZE)
+	     != FR_OK) ||
+	    (f_write(&trace_file, &trace_block, sizeof(trace_block), &count)
+	     != FR_OK) ||
+	    (count != sizeof(trace_block)) ||
+	    (f_sync(&trace_file) != FR_OK)) {
+		LOG("Failed to write trace block, disabling");
+		trace_nblocks = 0;
+		f_close(&trace_file);
+		return -1;
+	}
+
+	++trace_seq;
+
+	if (++trace_pos == trace_nblocks)
+		trace_pos = 0;
+
+	trace_block.count = 0;
+	trace_block.dropped = 0;
+
+	return 0;
+}
+
+#endif /* CONFIG_TRACE */
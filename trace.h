@@ -0,0 +1,99 @@
+/*
+  Plastic Logic EPD project on MSP430
+
+  Copyright (C) 2013 Plastic Logic Limited
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * trace.h -- Performance trace log
+ *
+ * Timing events are recorded in a RAM buffer and written in 512-byte blocks
+ * to a preallocated file on the SD card, which is used as a ring buffer.
+ * Nothing is written if the file does not exist.  Use tools/trace.py to
+ * create the file and to decode it.
+ *
+ */
+
+#ifndef TRACE_H
+#define TRACE_H 1
+
+#include <stdint.h>
+#include "config.h"
+
+/* Event identifiers, keep in sync with tools/trace.py */
+enum trace_event_id {
+	TRACE_LOAD_IMAGE = 1,		/* arg: image width */
+	TRACE_UPDATE,			/* arg: waveform id */
+	TRACE_WAIT_UPDATE_END,
+	TRACE_WAIT_IDLE,
+	TRACE_LOAD_WFLIB,		/* arg: size in KB */
+	TRACE_FLUSH,			/* arg: number of entries */
+	TRACE_PSU_ON,
+	TRACE_CPU_IDLE,
+};
+
+/* Set in the event id to mark the end of an event */
+#define TRACE_END 0x80
+
+#define TRACE_MAGIC 0x52544C50UL /* "PLTR" */
+#define TRACE_BLOCK_SIZE 512
+#define TRACE_BLOCK_ENTRIES 62
+
+struct trace_entry {
+	uint32_t time;			/* time_ticks() */
+	uint16_t arg;
+	uint8_t id;			/* enum trace_event_id | TRACE_END */
+	uint8_t reserved;
+};
+
+struct trace_block {
+	uint32_t magic;
+	uint32_t seq;			/* incremented with each block written */
+	uint16_t count;			/* number of valid entries */
+	uint16_t dropped;		/* entries lost because the buffer was full */
+	uint32_t reserved;
+	struct trace_entry entries[TRACE_BLOCK_ENTRIES];
+};
+
+#if CONFIG_TRACE
+
+/** Open the trace file and find where to resume writing, tracing is
+ * disabled if the file does not exist */
+extern int trace_init(const char *path);
+
+/** Record an event, not to be called from interrupt handlers */
+extern void trace_event(uint8_t id, uint16_t arg);
+
+/** Write the buffered events if the buffer is half full or if they have been
+ * waiting for more than TRACE_FLUSH_PERIOD seconds.  This must only be called
+ * when no other SD card access is in progress. */
+extern int trace_poll(void);
+
+/** Write the buffered events */
+extern int trace_flush(void);
+
+#else
+
+#define trace_init(_path) (0)
+#define trace_event(_id, _arg) do {} while (0)
+#define trace_poll() (0)
+#define trace_flush() (0)
+
+#endif /* CONFIG_TRACE */
+
+#define trace_begin(_id, _arg) trace_event((_id), (_arg))
+#define trace_end(_id, _arg) trace_event(((_id) | TRACE_END), (_arg))
+
+#endif /* TRACE_H */
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "FatFs/ff.h"
+#include "FatFs/diskio.h"
 #include "msp430-gpio.h"
 #include "pnm-utils.h"
 #include "assert.h"
@@ -192,6 +193,16 @@ void dump_hex(const void *data, uint16_t len)
 	puts(s);
 }
 
+void log_disk_cache_stats(void)
+{
+	DWORD stats[2];
+
+	if (disk_ioctl(0, MMC_GET_CACHE_STATS, stats) != RES_OK)
+		return;
+
+	LOG("SD cache: %lu hits, %lu misses", stats[0], stats[1]);
+}
+
 uint16_t align8(uint16_t value){
 	return (((value + 7)/8) * 8);
 }
@@ -63,10 +63,78 @@ enum bool_opts {
 
 /* -- Sleep & delay -- */
 
+/** Busy-wait, only for short hardware timings or with interrupts disabled */
 extern void udelay(uint16_t us);
 extern void mdelay(uint16_t ms);
+
+/** Sleep in LPM3 using the time base, timer callbacks keep running */
 extern void msleep(uint16_t ms);
 
+/* -- Clock governor -- */
+
+/** Run the CPU at a lower clock speed and core voltage during a long wait,
+ * calls can be nested and the full speed is restored by the last
+ * cpu_idle_end().  Bus transfers keep working but are slower. */
+extern void cpu_idle_begin(void);
+extern void cpu_idle_end(void);
+
+/** Keep the CPU at full speed until cpu_busy_end(), cpu_idle_begin() has no
+ * effect meanwhile.  This is for frequent short sleeps, which would otherwise
+ * change the clock speed each time. */
+extern void cpu_busy_begin(void);
+extern void cpu_busy_end(void);
+
+/* -- Time base -- */
+
+/** Number of time base ticks per second (ACLK = REFO) */
+#define TIME_TICKS_PER_SECOND 32768UL
+
+/** Start the free-running time base, also running in low-power modes */
+extern void time_init(void);
+
+/** Get the number of ticks since time_init() was called */
+extern uint32_t time_ticks(void);
+
+/** Get the number of microseconds since time_init() was called, with the
+ * time base resolution (about 30.5us).  This wraps around after about 71
+ * minutes so only differences should be used, see pl_time_since(). */
+extern uint32_t pl_time_now_us(void);
+
+/** Get the number of microseconds elapsed since start_us, a value returned
+ * by pl_time_now_us() less than 71 minutes ago */
+extern uint32_t pl_time_since(uint32_t start_us);
+
+/** Sleep until any of the mask bits is set in flags by an interrupt handler
+ * or the timeout in ticks has expired.  Interrupts must be enabled.  Return 0
+ * if a flag was set, -1 if the timeout expired.  */
+extern int time_wait_flag(volatile const uint8_t *flags, uint8_t mask,
+			  uint32_t timeout);
+
+/** Convert milliseconds to time base ticks, rounded up */
+#define TIME_MS_TO_TICKS(_ms) \
+	((((uint32_t)(_ms) * TIME_TICKS_PER_SECOND) + 999) / 1000)
+
+struct time_timer;
+
+/** Timer callback, called from the timer interrupt handler so it must be
+ * short: typically set a flag for the main loop or add the timer again */
+typedef void (*time_timer_fn)(struct time_timer *t);
+
+/** One-shot timer, owned by the caller until it has expired or been
+ * cancelled */
+struct time_timer {
+	struct time_timer *next;
+	uint32_t expires;
+	time_timer_fn callback;
+	void *data;
+};
+
+/** Call t->callback after delay ticks, the timer must not be pending */
+extern void time_timer_add(struct time_timer *t, uint32_t delay);
+
+/** Remove a pending timer, return 0 if it was pending or -1 otherwise */
+extern int time_timer_cancel(struct time_timer *t);
+
 /** Check for the presence of a file in FatFs */
 extern int is_file_present(const char *path);
 
@@ -88,6 +156,9 @@ extern int open_image(const char *dir, const char *file, FIL *f,
 /** Print the contents of a buffer with offsets on stdout */
 extern void dump_hex(const void *data, uint16_t len);
 
+/** Log the SD card sector cache hit and miss counters */
+extern void log_disk_cache_stats(void);
+
 
 /**
  * defines a structure representing a array scrambling configuration